@@ -7,6 +7,7 @@
 #define EVENTMIXER_CONFIG_H__
 
 #include <string>
+#include <cstddef>
 
 namespace config {
 
@@ -16,6 +17,32 @@ namespace config {
     const std::string muNegName = "lepN"; /**< Branch name of negative muon. */
   } InputTree; /**< Settings for input TTrees. */
 
+  /** possible layouts of the output TTree. */
+  enum class OutputLayout {
+    LorentzVectors, /**< one TLorentzVector object branch per four-momentum. */
+    PxPyPzE, /**< flat columns <name>_px, <name>_py, <name>_pz, <name>_E per four-momentum. */
+    PtEtaPhiM, /**< flat columns <name>_pt, <name>_eta, <name>_phi, <name>_mass per four-momentum. */
+    PairIndices /**< only the compressed indices of the input events (see ToyMCIndexOutEvent). Not for crossMixer. */
+  };
+
+  struct {
+    const OutputLayout layout = OutputLayout::LorentzVectors; /**< layout of the four-momenta in the output. */
+    const bool singlePrecision = false; /**< use float instead of double for the flat columns. */
+    const size_t indexBlockSize = 65536; /**< number of pairs per TTree entry for the PairIndices layout. */
+  } OutputFormat; /**< Settings for the layout of the output TTree. */
+
+  struct {
+    /**
+     * fill histograms of the mixed events (mass, pT, rapidity, cos theta-phi maps) instead of the output TTree.
+     * Always mixes the whole triangle, i.e. not possible with sharding, appending, Sampling, Pooling, Bucketing or
+     * Checkpoints.resume. No checkpoints are written (Checkpoints.interval is ignored).
+     */
+    const bool enabled = false;
+    const int nMassBins = 200; /**< bins of the mass histogram, over the mass window of the mixing. */
+    /** name of the histogram for which the bin-bin covariance is estimated (see BinCovariance), empty for none. */
+    const std::string covariance = "mass";
+  } OutputHistograms; /**< Settings for the histogram output (see HistogramSink). */
+
   struct {
     const std::string treeName = "genData"; /**< Name of the TTree in the output file. */
     const std::string muPosName = "lepP"; /**< Branch name for positive muon. */
@@ -24,15 +51,67 @@ namespace config {
   } OutputTree; /**< Settings for the output TTrees. */
 
   struct {
-    /** number of input events to use. Negative values -> use all of input. */
+    /**
+     * number of input events to use. Negative values -> use all of input.
+     * NOTE: this truncates the input. See Sampling for an unbiased way to reduce the number of mixed pairs.
+     */
     const long int maxEvents = -1;
+    /** read the input once into memory and mix from there instead of reading it for every combination. */
+    const bool preload = true;
+    /** skip pairs that can not be inside the mass window via a kinematic index (only with preloading). */
+    const bool pruneCandidates = true;
   } General; /**< General settings*/
 
+  struct {
+    const unsigned nThreads = 1; /**< number of threads to use for mixing. More than one implies preloading the input. */
+    const size_t tileSize = 512; /**< number of events per block in the tiles of the parallel loop. */
+    const bool deterministicOrder = true; /**< write the output in the same order as the serial loop. */
+  } Parallel; /**< Settings for the parallel mixing. */
+
+  struct {
+    const bool enabled = false; /**< mix only a random sample of all pairs (implies preloading the input). */
+    const unsigned long nSamples = 0; /**< number of pairs to sample. If 0, fraction is used. */
+    const double fraction = 0.01; /**< fraction of all pairs to sample. */
+    const unsigned long seed = 42; /**< seed for the sampling. */
+  } Sampling; /**< Settings for mixing a random sample of pairs, with weights nPairs / nSamples. */
+
+  struct {
+    const unsigned interval = 1800; /**< seconds between two checkpoints of the serial loops. 0 -> no checkpoints. */
+    /** continue from the checkpoint in the output file (if there is one). Only for the serial loops and shards. */
+    const bool resume = false;
+  } Checkpoints; /**< Settings for checkpointing long running jobs. */
+
+  struct {
+    const bool enabled = false; /**< mix only events in the same bucket of dimuon rapidity (implies preloading the input). */
+    const double rapidityWidth = 0.2; /**< width of the rapidity buckets. */
+    const bool mixNeighbours = true; /**< also mix events in adjacent rapidity buckets. */
+  } Bucketing; /**< Settings for mixing only events with similar dimuon rapidity. */
+
+  struct {
+    const bool enabled = false; /**< mix every event only with the most recent events of its rapidity bucket. */
+    const size_t depth = 10; /**< number of most recent events every event is mixed with. */
+  } Pooling; /**< Settings for the rolling event pool mixing (uses Bucketing.rapidityWidth for the categories). */
+
+  struct {
+    const size_t memoryBudgetMB = 1024; /**< memory for the in-memory block of the first input sample (in MB). */
+    const size_t chunkSize = 4096; /**< number of events of the second input sample that are read at once. */
+  } CrossMixing; /**< Settings for mixing two different input samples (crossMixer). */
+
   struct {
     const double massLow = 2.0; /**< lower bound of mass range in GeV.*/
     const double massHigh = 4.0; /**< upper bound of mass range in GeV.*/
   } ToyMCMixConditions; /**< Settings for when to mix Toy MC events. */
 
+  struct {
+    const std::string photonName = "photon"; /**< Branch name of the photon in the input and the output TTree. */
+    const std::string diMuName = "jpsi"; /**< Branch name for the dimuon in the output TTree. */
+    const std::string tripletName = "chic"; /**< Branch name for the dimuon + photon in the output TTree. */
+    const double pairLow = 2.95; /**< lower bound of the dimuon mass in GeV. */
+    const double pairHigh = 3.25; /**< upper bound of the dimuon mass in GeV. */
+    const double massLow = 3.3; /**< lower bound of the dimuon + photon mass in GeV. */
+    const double massHigh = 3.7; /**< upper bound of the dimuon + photon mass in GeV. */
+  } TripletMixing; /**< Settings for mixing mu+, mu- and photon from three different events (tripletMixer). */
+
   struct {
     const std::string filename = "/afs/hephy.at/work/t/tmadlener/ChiPol/ToyMC/EventMixing/progress_3.5GeV.out"; /**< logfile name. Set to empty string for output to stdout*/
   } Logging;
@@ -0,0 +1,132 @@
+#ifndef EVENTMIXER_BINCOVARIANCE_H__
+#define EVENTMIXER_BINCOVARIANCE_H__
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <iostream>
+#include <cstddef>
+
+/**
+ * Streaming estimate of the bin-bin covariance matrix of a histogram of mixed events.
+ *
+ * The bins of a mixed-event histogram are correlated, since every input event is used in many pairs. With c_k the
+ * (weighted) contents that all pairs containing input event k put into the bins, the histogram is H = 1/2 sum_k c_k
+ * and to leading order in the number of input events N (as for any U-statistic of order 2)
+ *   Cov(H) = sum_k (c_k - cbar) (c_k - cbar)^T = sum_k c_k c_k^T - (sum_k c_k) (sum_k c_k)^T / N.
+ *
+ * add(k, bin, w) is called for both input events of every filled pair and adds w to the content of the bin in c_k,
+ * so that only one number per touched bin is kept for every event that is not yet complete (and nothing per pair).
+ * Once all pairs of event k have been added, fold(k) adds c_k to the running sums and releases it. Folding costs
+ * O(m^2) for an event with contributions in m bins, i.e. up to O(nBins^2) per event, which is large for 2D
+ * histograms (e.g. 6.3e6 for the 66 x 38 cells of a 64 x 36 cos theta-phi map with under- and overflow).
+ * The running sums need nBins^2 doubles.
+ */
+class BinCovariance {
+public:
+  BinCovariance() = delete;
+
+  BinCovariance(const size_t nBins) : m_nBins(nBins), m_sumOuter(nBins * nBins), m_sum(nBins) {;}
+
+  /** add weight w in (global) bin to the contributions of input event k. */
+  void add(const size_t k, const int bin, const double w);
+
+  /** fold the contributions of input event k into the running sums. Has to be called once for every input event. */
+  void fold(const size_t k);
+
+  /**
+   * add the pending contributions and the running sums of other. Every event has to be folded in at most one of
+   * the two (e.g. by merging the unfolded parts of several threads and folding all events afterwards).
+   */
+  void merge(const BinCovariance& other);
+
+  /**
+   * move the pending contributions of other into this, leaving other without pending contributions (but with its
+   * running sums). Allows to fold events in a shared BinCovariance that are filled on several threads.
+   */
+  void take(BinCovariance& other);
+
+  /** number of folded input events. */
+  size_t nEvents() const { return m_n; }
+
+  size_t nBins() const { return m_nBins; }
+
+  /** the covariance matrix (row major, nBins x nBins) of the folded events. */
+  std::vector<double> matrix() const;
+
+private:
+  size_t m_nBins;
+
+  /** contributions per event that has not been folded yet, summed per bin. */
+  std::unordered_map<size_t, std::unordered_map<int, double> > m_pending;
+
+  std::vector<double> m_sumOuter; /**< sum_k c_k c_k^T. */
+
+  std::vector<double> m_sum; /**< sum_k c_k. */
+
+  size_t m_n{};
+};
+
+void BinCovariance::add(const size_t k, const int bin, const double w)
+{
+  if (bin < 0 || size_t(bin) >= m_nBins) return;
+  m_pending[k][bin] += w;
+}
+
+void BinCovariance::fold(const size_t k)
+{
+  m_n++;
+  const auto it = m_pending.find(k);
+  if (it == m_pending.end()) return;
+
+  const std::vector<std::pair<size_t, double> > c(it->second.begin(), it->second.end());
+  m_pending.erase(it);
+
+  for (const auto& a : c) {
+    m_sum[a.first] += a.second;
+    double* row = m_sumOuter.data() + a.first * m_nBins;
+    for (const auto& b : c) row[b.first] += a.second * b.second;
+  }
+}
+
+void BinCovariance::merge(const BinCovariance& other)
+{
+  if (other.m_nBins != m_nBins) {
+    std::cerr << "Cannot merge BinCovariances with different numbers of bins" << std::endl;
+    return;
+  }
+
+  for (const auto& pending : other.m_pending) {
+    auto& mine = m_pending[pending.first];
+    for (const auto& contribution : pending.second) mine[contribution.first] += contribution.second;
+  }
+  for (size_t b = 0; b < m_sumOuter.size(); ++b) m_sumOuter[b] += other.m_sumOuter[b];
+  for (size_t b = 0; b < m_nBins; ++b) m_sum[b] += other.m_sum[b];
+  m_n += other.m_n;
+}
+
+void BinCovariance::take(BinCovariance& other)
+{
+  if (other.m_nBins != m_nBins) {
+    std::cerr << "Cannot take contributions from a BinCovariance with a different number of bins" << std::endl;
+    return;
+  }
+
+  for (const auto& pending : other.m_pending) {
+    auto& mine = m_pending[pending.first];
+    for (const auto& contribution : pending.second) mine[contribution.first] += contribution.second;
+  }
+  other.m_pending.clear();
+}
+
+std::vector<double> BinCovariance::matrix() const
+{
+  std::vector<double> cov(m_sumOuter);
+  if (!m_n) return cov;
+  for (size_t a = 0; a < m_nBins; ++a) {
+    for (size_t b = 0; b < m_nBins; ++b) cov[a * m_nBins + b] -= m_sum[a] * m_sum[b] / m_n;
+  }
+  return cov;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef EVENTMIXER_BUCKETINDEX_H__
+#define EVENTMIXER_BUCKETINDEX_H__
+
+#include "MuonStore.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstddef>
+
+/** Settings for mixing only events in the same (or in neighbouring) buckets. */
+struct BucketSettings {
+  /**
+   * offsets d != 0 of the buckets b + d that are also mixed with bucket b (besides b itself). The sign does not
+   * matter, as the pairs between b and b + d are the same as between b + d and b.
+   */
+  std::vector<long> neighbours;
+};
+
+/**
+ * Events of a MuonStore partitioned by a bucket key (e.g. a bin in dimuon rapidity).
+ * The events are copied into a new store in which the buckets are contiguous ranges, ordered by ascending key
+ * and with the events in their original order inside each bucket. entry() of this store still refers to the
+ * input TTree, so that it can be used instead of the original store for mixing.
+ */
+class BucketIndex {
+public:
+  /** one bucket in the partitioned store. */
+  struct Bucket {
+    long key;
+    size_t begin; /**< first event in the partitioned store. */
+    size_t end; /**< one past the last event in the partitioned store. */
+
+    size_t size() const { return end - begin; }
+  };
+
+  BucketIndex() = delete;
+
+  /** partition the events of store, where keys[k] is the bucket key of event k. */
+  BucketIndex(const MuonStore& store, const std::vector<long>& keys);
+
+  /** the partitioned store. */
+  const MuonStore& store() const { return m_store; }
+
+  /** all non-empty buckets in ascending order of their keys. */
+  const std::vector<Bucket>& buckets() const { return m_buckets; }
+
+  /** get the bucket with the passed key or nullptr if there is no such (non-empty) bucket. */
+  const Bucket* find(const long key) const;
+
+  /** normalize the neighbour offsets: positive, unique, sorted, without 0. */
+  static std::vector<long> neighbourOffsets(const std::vector<long>& neighbours);
+
+private:
+  MuonStore m_store;
+
+  std::vector<Bucket> m_buckets;
+
+  std::unordered_map<long, size_t> m_position; /**< position of a key in m_buckets. */
+};
+
+BucketIndex::BucketIndex(const MuonStore& store, const std::vector<long>& keys)
+{
+  std::unordered_map<long, std::vector<size_t> > partition;
+  for (size_t k = 0; k < store.size(); ++k) partition[keys[k]].push_back(k);
+
+  std::vector<long> sortedKeys;
+  sortedKeys.reserve(partition.size());
+  for (const auto& bucket : partition) sortedKeys.push_back(bucket.first);
+  std::sort(sortedKeys.begin(), sortedKeys.end());
+
+  m_store.reserve(store.size());
+  for (const long key : sortedKeys) {
+    const size_t begin = m_store.size();
+    for (const size_t k : partition[key]) m_store.add(store.pos().get(k), store.neg().get(k), store.entry(k));
+    m_position[key] = m_buckets.size();
+    m_buckets.push_back(Bucket{key, begin, m_store.size()});
+  }
+}
+
+const BucketIndex::Bucket* BucketIndex::find(const long key) const
+{
+  const auto it = m_position.find(key);
+  return it == m_position.end() ? nullptr : &m_buckets[it->second];
+}
+
+std::vector<long> BucketIndex::neighbourOffsets(const std::vector<long>& neighbours)
+{
+  std::vector<long> offsets;
+  for (const long d : neighbours) {
+    if (d) offsets.push_back(d < 0 ? -d : d);
+  }
+  std::sort(offsets.begin(), offsets.end());
+  offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+  return offsets;
+}
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef EVENTMIXER_CROSSEVENTMIXER_H__
+#define EVENTMIXER_CROSSEVENTMIXER_H__
+
+#include "EventMixer.h"
+#include "MuonStore.h"
+#include "EventSink.h"
+#include "general/progress.h"
+
+#include "TTree.h"
+#include "TFile.h"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+/** Settings for the block-nested-loop mixing of two input TTrees. */
+struct CrossMixSettings {
+  size_t memoryBudgetMB{1024}; /**< memory for the in-memory block of sample A (in MB). */
+  size_t chunkSize{4096}; /**< number of events of sample B that are read at once. */
+  long int maxEventsA{-1}; /**< number of events to use from sample A. Negative -> all. */
+  long int maxEventsB{-1}; /**< number of events to use from sample B. Negative -> all. */
+};
+
+namespace mixer_detail {
+  template<typename CondF, typename SinkT>
+  auto mixCrossRow(CondF& cond, const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t jBegin,
+                   size_t jEnd, SinkT& sink, Priority<2>)
+    -> decltype(cond.block(storeA, i, storeB, jBegin, jEnd, sink), void())
+  {
+    cond.block(storeA, i, storeB, jBegin, jEnd, sink);
+  }
+
+  template<typename CondF, typename SinkT>
+  auto mixCrossRow(CondF& cond, const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t jBegin,
+                   size_t jEnd, SinkT& sink, Priority<1>)
+    -> typename std::enable_if<std::is_void<decltype(cond(storeA, i, storeB, jBegin, sink))>::value>::type
+  {
+    for (size_t j = jBegin; j < jEnd; ++j) cond(storeA, i, storeB, j, sink);
+  }
+
+  template<typename CondF, typename SinkT>
+  void mixCrossRow(CondF& cond, const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t jBegin,
+                   size_t jEnd, SinkT& sink, Priority<0>)
+  {
+    for (size_t j = jBegin; j < jEnd; ++j) {
+      for (const auto& event : cond(storeA, i, storeB, j)) sink.push_back(event);
+    }
+  }
+}
+
+/**
+ * Mix event i of storeA with the events [jBegin, jEnd) of storeB. Same as mixStoreRow, but with the contracts
+ * cond.block(storeA, i, storeB, jBegin, jEnd, sink), cond(storeA, i, storeB, j, sink) and
+ * cond(storeA, i, storeB, j) (returning a vector).
+ */
+template<typename CondF, typename SinkT>
+inline void mixCrossRow(CondF& cond, const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t jBegin,
+                        size_t jEnd, SinkT& sink)
+{
+  mixer_detail::mixCrossRow(cond, storeA, i, storeB, jBegin, jEnd, sink, mixer_detail::Priority<2>());
+}
+
+/**
+ * Mixer for combining every event of an input TTree A with every event of a different input TTree B (e.g. data
+ * with MC or two run periods), where neither of the two has to fit into memory.
+ *
+ * Uses a block nested loop: A is read in blocks that fit into settings.memoryBudgetMB, and for every block all of
+ * B is streamed through in chunks of settings.chunkSize events. Hence A is read once and B once per block of A.
+ * Output order: block of A, chunk of B, event of A, event of B.
+ *
+ * EventT has the same requirements as for EventMixer::preload (muPos() and muNeg()), OutEventT the same as for
+ * EventMixer. The interface of cond has to be equivalent to one of (see mixCrossRow):
+ * \code{.cpp}
+ * void block(const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t jBegin, size_t jEnd, SinkT& sink);
+ * void cond(const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t j, SinkT& sink);
+ * std::vector<OutEventT> cond(const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t j);
+ * \endcode
+ * where the store.entry() are the entries in the TTrees A and B respectively.
+ *
+ * Takes ownership of the passed TTrees.
+ */
+template<typename EventT, typename OutEventT>
+class CrossEventMixer {
+public:
+  CrossEventMixer() = delete;
+
+  CrossEventMixer(TTree* treeA, TTree* treeB, const std::string& outFileName, const std::string& outTreeName);
+
+  template<typename CondF>
+  void mix(CondF cond, const CrossMixSettings& settings, const std::string& logfile = "");
+
+  /** write the output TTree to the output file and close the file. */
+  void writeToFile();
+
+private:
+  /** fill the store with the entries [begin, end) of the tree. */
+  void load(TTree* tree, EventT& event, const size_t begin, const size_t end, MuonStore& store);
+
+  EventT m_eventA;
+
+  EventT m_eventB;
+
+  OutEventT m_outEvent;
+
+  std::unique_ptr<TTree> m_treeA;
+
+  std::unique_ptr<TTree> m_treeB;
+
+  TTree* m_outTree{nullptr}; /**< Output TTree. for ROOT reasons not a std::unique_ptr. */
+
+  TFile* m_outFile{nullptr}; /**< Output TFile. for ROOT reasons not a std::unique_ptr. */
+};
+
+template<typename EventT, typename OutEventT>
+CrossEventMixer<EventT, OutEventT>::CrossEventMixer(TTree* treeA, TTree* treeB, const std::string& outFileName,
+                                                    const std::string& outTreeName)
+  : m_treeA(treeA), m_treeB(treeB)
+{
+  m_eventA.Init(m_treeA);
+  m_eventB.Init(m_treeB);
+
+  m_outFile = new TFile(outFileName.c_str(), "recreate");
+  m_outTree = new TTree(outTreeName.c_str(), "cross mixed events tree");
+  m_outTree->SetDirectory(m_outFile);
+
+  m_outEvent.Init(m_outTree);
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void CrossEventMixer<EventT, OutEventT>::mix(CondF cond, const CrossMixSettings& settings,
+                                             const std::string& logfile)
+{
+  const auto nEvents = [](TTree* tree, const long int maxEvents) -> size_t {
+    const long int nInput = tree->GetEntries();
+    return (maxEvents < 0 || maxEvents > nInput) ? nInput : maxEvents;
+  };
+  const size_t nA = nEvents(m_treeA.get(), settings.maxEventsA);
+  const size_t nB = nEvents(m_treeB.get(), settings.maxEventsB);
+  const uint64_t nCombinations = uint64_t(nA) * nB;
+
+  const size_t blockSize = std::max(size_t(1), settings.memoryBudgetMB * 1024 * 1024 / MuonStore::bytesPerEvent());
+  const size_t chunkSize = std::max(size_t(1), settings.chunkSize);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting cross mixing of " << nA << " events of sample A with " << nB << " events of sample B in "
+            << (nA + blockSize - 1) / blockSize << " block(s) of A. Possible (input) combinations: "
+            << nCombinations << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nCombinations, logstream);
+
+  MuonStore storeA;
+  MuonStore storeB;
+  storeA.reserve(std::min(nA, blockSize));
+  storeB.reserve(std::min(nB, chunkSize));
+
+  uint64_t trials{};
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  for (size_t aBegin = 0; aBegin < nA; aBegin += blockSize) {
+    load(m_treeA.get(), m_eventA, aBegin, std::min(nA, aBegin + blockSize), storeA);
+
+    for (size_t bBegin = 0; bBegin < nB; bBegin += chunkSize) {
+      load(m_treeB.get(), m_eventB, bBegin, std::min(nB, bBegin + chunkSize), storeB);
+
+      for (size_t i = 0; i < storeA.size(); ++i) {
+        mixCrossRow(cond, storeA, i, storeB, 0, storeB.size(), sink);
+      }
+      trials += uint64_t(storeA.size()) * storeB.size();
+      progress(trials);
+    }
+  }
+
+  std::cout << "created " << sink.size() << " new events from " << trials << " possible (input) combinations."
+            << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+void CrossEventMixer<EventT, OutEventT>::load(TTree* tree, EventT& event, const size_t begin, const size_t end,
+                                              MuonStore& store)
+{
+  store.clear();
+  for (size_t k = begin; k < end; ++k) {
+    tree->GetEntry(k);
+    store.add(event, k);
+  }
+}
+
+template<typename EventT, typename OutEventT>
+void CrossEventMixer<EventT, OutEventT>::writeToFile()
+{
+  flushOutput(m_outEvent, m_outTree);
+  m_outFile->cd();
+  m_outTree->Write();
+  m_outFile->Write();
+  m_outFile->Close();
+}
+
+#endif
@@ -2,15 +2,120 @@
 #define EVENTMIXER_EVENTMIXER_H__
 
 #include "MiscHelper.h"
+#include "MuonStore.h"
+#include "TiledTriangle.h"
+#include "PruningIndex.h"
+#include "PairSampler.h"
+#include "MixCheckpoint.h"
+#include "EventSink.h"
+#include "Sharding.h"
+#include "BucketIndex.h"
+#include "EventPool.h"
+#include "WindowSink.h"
+#include "MixManifest.h"
 #include "general/progress.h"
 
 #include "TTree.h"
 #include "TLorentzVector.h"
 #include "TFile.h"
+#include "TROOT.h"
 
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <type_traits>
+#include <mutex>
+
+namespace mixer_detail {
+  /** overload priority for choosing between the different cond contracts. Higher N is preferred. */
+  template<unsigned N>
+  struct Priority : Priority<N - 1> {};
+
+  template<>
+  struct Priority<0> {};
+
+  template<typename CondF, typename SinkT>
+  auto mixStoreRow(CondF& cond, const MuonStore& store, size_t i, size_t jBegin, size_t jEnd, SinkT& sink,
+                   Priority<2>) -> decltype(cond.block(store, i, jBegin, jEnd, sink), void())
+  {
+    cond.block(store, i, jBegin, jEnd, sink);
+  }
+
+  // only if the sink version returns void, e.g. a std::bind object would silently drop the sink argument
+  template<typename CondF, typename SinkT>
+  auto mixStoreRow(CondF& cond, const MuonStore& store, size_t i, size_t jBegin, size_t jEnd, SinkT& sink,
+                   Priority<1>) -> typename std::enable_if<std::is_void<decltype(cond(store, i, jBegin, sink))>::value>::type
+  {
+    for (size_t j = jBegin; j < jEnd; ++j) cond(store, i, j, sink);
+  }
+
+  template<typename CondF, typename SinkT>
+  void mixStoreRow(CondF& cond, const MuonStore& store, size_t i, size_t jBegin, size_t jEnd, SinkT& sink,
+                   Priority<0>)
+  {
+    for (size_t j = jBegin; j < jEnd; ++j) {
+      for (const auto& event : cond(store, i, j)) sink.push_back(event);
+    }
+  }
+
+  template<typename CondF, typename EventT, typename SinkT>
+  auto mixTreePair(CondF& cond, const EventT& e1, const EventT& e2, size_t i, size_t j, SinkT& sink,
+                   Priority<1>) -> typename std::enable_if<std::is_void<decltype(cond(e1, e2, i, j, sink))>::value>::type
+  {
+    cond(e1, e2, i, j, sink);
+  }
+
+  template<typename CondF, typename EventT, typename SinkT>
+  void mixTreePair(CondF& cond, const EventT& e1, const EventT& e2, size_t i, size_t j, SinkT& sink, Priority<0>)
+  {
+    for (const auto& event : cond(e1, e2, i, j)) sink.push_back(event);
+  }
+}
+
+/**
+ * Mix event i of the store with the events [jBegin, jEnd) and append the output to sink (see EventSink.h).
+ * Uses cond.block(store, i, jBegin, jEnd, sink) if the condition provides it (e.g. to test a whole block of events
+ * at once), cond(store, i, j, sink) for every j if that is available and cond(store, i, j) (returning a vector)
+ * otherwise. Either way the output is in ascending order of j.
+ */
+template<typename CondF, typename SinkT>
+inline void mixStoreRow(CondF& cond, const MuonStore& store, size_t i, size_t jBegin, size_t jEnd, SinkT& sink)
+{
+  mixer_detail::mixStoreRow(cond, store, i, jBegin, jEnd, sink, mixer_detail::Priority<2>());
+}
+
+/** Mix the two events from the input TTree using cond(e1, e2, i, j, sink) if available and cond(e1, e2, i, j). */
+template<typename CondF, typename EventT, typename SinkT>
+inline void mixTreePair(CondF& cond, const EventT& e1, const EventT& e2, size_t i, size_t j, SinkT& sink)
+{
+  mixer_detail::mixTreePair(cond, e1, e2, i, j, sink, mixer_detail::Priority<1>());
+}
+
+/**
+ * Same as mixStoreRow, but going only through the candidates of index (if it is not nullptr, see PruningIndex),
+ * which has to be built for store.
+ */
+template<typename CondF, typename SinkT>
+void mixIndexedRow(CondF& cond, const MuonStore& store, const PruningIndex* index, size_t i, size_t jBegin,
+                   size_t jEnd, SinkT& sink)
+{
+  std::vector<size_t> cands;
+  if (!index || !index->candidates(i, jBegin, jEnd, cands)) {
+    mixStoreRow(cond, store, i, jBegin, jEnd, sink);
+    return;
+  }
+
+  // mix runs of consecutive candidates in one go, so that a block condition can still be used on them
+  for (size_t k = 0; k < cands.size();) {
+    size_t end = k + 1;
+    while (end < cands.size() && cands[end] == cands[end - 1] + 1) ++end;
+    mixStoreRow(cond, store, i, cands[k], cands[end - 1] + 1, sink);
+    k = end;
+  }
+}
 
 /**
  * EventMixer class to mix different Events from one TTree.
@@ -25,6 +130,8 @@
  * The Init() function has to do all necessary initialization (Setting branch addresses, etc.)
  *
  * Other than that their interfaces are dictated by the the needs of the used cond function in ::mix().
+ * For resuming from a checkpoint OutEventT also has to provide an ::Attach(TTree*) function, that sets the branch
+ * addresses of an already existing output TTree.
  *
  * Note takes ownership of the passed TTree!.
  */
@@ -36,8 +143,15 @@ public:
   /**
    * Constructor taking the input TTree* and the names for the output file and the TTree therein.
    * Initializes the internal Event classes and creates the output file and TTree.
+   *
+   * If resume is set and the output file already contains the output TTree with a checkpoint (see
+   * enableCheckpoints), the TTree is opened for appending and the next call to mix, mixInMemory or mixShard
+   * continues from the checkpoint. Otherwise a new output file is created.
+   * If the checkpoint has been written for another input (other files or number of entries), the output file is
+   * closed without changing it and failed() is set, so that nothing is mixed or written.
    */
-  EventMixer(TTree* inTree, const std::string& outFileName, const std::string& outTreeName);
+  EventMixer(TTree* inTree, const std::string& outFileName, const std::string& outTreeName,
+             const bool resume = false);
 
   /**
    * Loop over all possible event combinations exactly once and do conditional event mixing.
@@ -53,6 +167,13 @@ public:
    * The events e1 and e2 are checked for compatibility and the vector has to be filled inside the function.
    * The two indices i & j are the indices of the e1 (e2 resp.) in the input TTree.
    *
+   * Alternatively cond can emplace its output into a sink (see EventSink.h), which writes it directly into the
+   * output TTree without creating temporary OutEventTs:
+   * \code{.cpp}
+   * void cond(const EventT& e1, const EventT& e2, size_t i, size_t j, SinkT& sink);
+   * \endcode
+   * The sink version is used if cond provides it.
+   *
    * The number of events to be processed can be controlled via the maxEvents variable. Setting it to a negative
    * value results in taking all events present in the input TTree.
    *
@@ -62,9 +183,190 @@ public:
   template<typename CondF>
   void mix(CondF cond, const long int maxEvents = -1, const std::string& logfile = "");
 
+  /**
+   * Read the first maxEvents events of the input TTree once and keep the muon kinematics in an in-memory
+   * MuonStore. EventT has to provide muPos() and muNeg() returning the TLorentzVectors of the two muons.
+   * Does nothing if the store already holds exactly these events.
+   */
+  void preload(const long int maxEvents = -1);
+
+  /**
+   * Same loop as mix, but running purely in memory on the MuonStore filled by preload() (called internally),
+   * so that the input TTree is read only once instead of once per combination.
+   *
+   * The interface of cond has to be equivalent to:
+   * \code{.cpp}
+   * std::vector<OutEventT> cond(const MuonStore& store, size_t i, size_t j);
+   * \endcode
+   * where i and j are indices into the store (use store.entry() to get the entries in the input TTree).
+   * If cond additionally provides
+   * \code{.cpp}
+   * void block(const MuonStore& store, size_t i, size_t jBegin, size_t jEnd, std::vector<OutEventT>& out);
+   * \endcode
+   * that is used to process all j in [jBegin, jEnd) at once. It has to append the same output as calling cond for
+   * each j in ascending order would produce. Both can also take a sink instead of returning a vector (see mix and
+   * EventSink.h), which is preferred if it is available. out can then be a sink as well.
+   */
+  template<typename CondF>
+  void mixInMemory(CondF cond, const long int maxEvents = -1, const std::string& logfile = "");
+
+  /**
+   * Same as mixInMemory, but only mixing shard of nShards (0 <= shard < nShards) parts of the triangle of all
+   * pairs, such that every part has the same number of pairs (see shardPairRange). The part is stored in the
+   * UserInfo of the output TTree (see ShardInfo), so that the outputs of all shards can be merged into the output
+   * of mixInMemory (see mergeShards). mixInMemory is the same as mixing shard 0 of 1.
+   */
+  template<typename CondF>
+  void mixShard(CondF cond, const unsigned shard, const unsigned nShards, const long int maxEvents = -1,
+                const std::string& logfile = "");
+
+  /**
+   * Mix only the events that have been added to the input TTree since the output previousOutput has been created,
+   * i.e. all pairs i < j with n <= j < N, where the first n input events have already been mixed into previousOutput
+   * (see MixManifest) and N is the number of input events now. The output is a delta that can be chained with
+   * previousOutput (in that order). previousOutput has to be the latest output of a chain, and the first n input
+   * events have to be the same as for previousOutput (this is not checked).
+   * cond has the same interface as for mixInMemory. No checkpoints are written.
+   */
+  template<typename CondF>
+  void mixAppend(CondF cond, const std::string& previousOutput, const long int maxEvents = -1,
+                 const std::string& logfile = "");
+
+  /**
+   * Mix only events that are in the same bucket, or in buckets that are configured as neighbours (see
+   * BucketSettings), instead of all pairs. bucket has to be callable as
+   * \code{.cpp}
+   * long bucket(const EventT& event);
+   * \endcode
+   * and is called once for every input event (i.e. the input TTree is read once more after preloading).
+   * The events are partitioned by bucket (see BucketIndex) and each bucket b is mixed with itself and then with
+   * the buckets b + d for all neighbour offsets d > 0, in ascending order of b. cond has the same interface as for
+   * mixInMemory, with i < j being indices into BucketIndex::store().
+   *
+   * The number of mixed pairs and created events for each combination of buckets is written to the TTree
+   * "bucketCounts" in the output file (branches bucketA, bucketB, nEventsA, nEventsB, nPairs, nMixed).
+   */
+  template<typename CondF, typename BucketF>
+  void mixBucketed(CondF cond, BucketF bucket, const BucketSettings& settings = BucketSettings(),
+                   const long int maxEvents = -1, const std::string& logfile = "");
+
+  /**
+   * Mix every event only with the settings.depth most recent events before it that are in the same category,
+   * instead of with all other events ("event pool" mixing, see EventPool). category has to be callable as
+   * \code{.cpp}
+   * long category(const EventT& event);
+   * \endcode
+   * This is a single pass over the input TTree (which can also be a TChain) with linear cost and constant memory,
+   * that does not preload the input. cond has the same interface as for mixInMemory, where i is the newest event
+   * in the pool store and j runs over the other events in it (so that i > j is possible).
+   */
+  template<typename CondF, typename CategoryF>
+  void mixPool(CondF cond, CategoryF category, const PoolSettings& settings = PoolSettings(),
+               const long int maxEvents = -1, const std::string& logfile = "");
+
+  /**
+   * Parallel version of mixInMemory. The triangle of all pairs is split into tiles of settings.tileSize blocks
+   * of events, which are processed on settings.nThreads threads. Each thread collects the output of a tile in its
+   * own buffer (of OutputRecord<OutEventT>::type) and all buffers are written to the output TTree from the
+   * calling thread.
+   * If settings.deterministic is set, the output is written in the same order as by mixInMemory.
+   *
+   * cond has the same interface as for mixInMemory, but is called concurrently from several threads!
+   */
+  template<typename CondF>
+  void mixParallel(CondF cond, const TileSettings& settings, const long int maxEvents = -1,
+                   const std::string& logfile = "");
+
+  /**
+   * Same loop as mixInMemory, but putting the output into the passed sink instead of the output TTree (e.g. a
+   * HistogramSink). Nothing is written to the output TTree, use writeToFile(sink) to store the sink instead.
+   * cond has to provide one of the sink versions of the interface of mixInMemory. No checkpoints are written.
+   * endRow(sink, entry) (see EventSink.h) is called for every input event, once all of its pairs are in the sink.
+   */
+  template<typename CondF, typename SinkT>
+  void mixToSink(CondF cond, SinkT& sink, const long int maxEvents = -1, const std::string& logfile = "");
+
+  /**
+   * Same loop as mixInMemory, but splitting the output into several mass windows in one pass: every window k gets
+   * its own output TTree <outTreeName>_<k> (with the window as title) in the output file, that contains the output
+   * events of cond whose dimuon mass is in the window (see WindowSink). The output TTree passed to the constructor
+   * is not written. cond has to accept (at least) all pairs in the envelope of the windows (and pruning has to be
+   * enabled for the envelope only) and has to provide one of the sink versions of the interface of mixInMemory.
+   * No checkpoints are written.
+   */
+  template<typename CondF>
+  void mixWindows(CondF cond, const std::vector<MassWindow>& windows, const long int maxEvents = -1,
+                  const std::string& logfile = "");
+
+  /**
+   * Parallel version of mixToSink. Every worker thread fills its own copy of sink (created with the copy
+   * constructor of SinkT, before any of them is filled), which are added to sink with
+   * \code{.cpp}
+   * void SinkT::merge(const SinkT& other);
+   * \endcode
+   * at the end, in the order of the threads. The order in which pairs are put into a copy is not defined.
+   * Every row is processed by one worker, which afterwards moves the information of the events that are not yet
+   * complete from its copy into sink (see takeOpen in EventSink.h) and calls endRow(sink, entry) for all events
+   * whose rows and all rows before are done, so that the per event information is folded while mixing.
+   * cond has the same interface as for mixToSink, but is called concurrently from several threads!
+   */
+  template<typename CondF, typename SinkT>
+  void mixParallelToSink(CondF cond, SinkT& sink, const TileSettings& settings, const long int maxEvents = -1,
+                         const std::string& logfile = "");
+
+  /**
+   * Mix only a uniform random sample (without replacement) of all pairs i < j of the in-memory store, instead of
+   * all of them. The sample is defined by settings (see PairSampling) and is drawn and processed in chunks of at most
+   * settings.chunkSize pairs (see PairSampleStream), each of them in the same order as in the full loop. Every output event gets the weight nPairs / nSamples via OutEventT::setWeight(double), so that
+   * weighted distributions are unbiased estimates of the ones from mixing all pairs.
+   *
+   * cond has the same interface as for mixInMemory.
+   */
+  template<typename CondF>
+  void mixSampled(CondF cond, const PairSampling& settings, const long int maxEvents = -1,
+                  const std::string& logfile = "");
+
+  /**
+   * Skip pairs that can not have a mass in (massLow, massHigh) in the in-memory loops (mixInMemory, mixShard,
+   * mixParallel and mixBucketed) using a PruningIndex, which is built once after the input has been preloaded.
+   * Only use this with a cond that rejects all pairs outside this window! The output is then identical to
+   * the one without pruning.
+   */
+  void enablePruning(const double massLow, const double massHigh);
+
+  /**
+   * Write a checkpoint at the end of the first row of mix, mixInMemory or mixShard that finishes at least intervalSeconds
+   * after the previous checkpoint, and at the end of the loop. A checkpoint flushes all output to the file and
+   * stores the position of the loop and its counters with the output TTree. A job that is killed can then be
+   * restarted with resume set in the constructor and gives the same output as an uninterrupted run.
+   * 0 disables checkpoints (default). The other loops do not write checkpoints.
+   * The state at the end of mix, mixInMemory and mixShard is stored with the output TTree also if checkpoints are
+   * disabled (and then written with writeToFile), as record that the loop has been completed (see mergeShards).
+   */
+  void enableCheckpoints(const unsigned intervalSeconds);
+
+  /** true if the output has been opened from a checkpoint. */
+  bool resumed() const { return m_resumed; }
+
+  /**
+   * true if resuming from a checkpoint has been refused, because it has been written for another input, number of
+   * events or shard. The output file is then closed unchanged and all mix functions and writeToFile do nothing.
+   */
+  bool failed() const { return m_failed; }
+
+  /** the in-memory store of the input events (empty unless preload() has been called). */
+  const MuonStore& store() const { return m_store; }
+
   /** write the output TTree to the output file and close the file. */
   void writeToFile();
 
+  /**
+   * write the content of the sink to the output file (via SinkT::write(TDirectory*)) instead of the (empty)
+   * output TTree and close the file.
+   */
+  template<typename SinkT>
+  void writeToFile(const SinkT& sink);
+
 private:
   EventT m_event1; /**< Event associated to the i index in the mix loop and the m_inTree. */
 
@@ -81,16 +383,85 @@ private:
 
   TFile* m_outFile{nullptr}; /**< Output TFile. for ROOT reasons not a std::unique_ptr. */
 
+  std::vector<TTree*> m_windowTrees; /**< Output TTrees of mixWindows. Owned by m_outFile. */
+
+  MuonStore m_store; /**< In-memory copy of the input muons. Only filled by preload(). */
+
+  bool m_pruning{false}; /**< use the PruningIndex in the in-memory loops. */
+
+  double m_pruneMassLow{}; /**< lower bound of the mass window for the pruning. */
+
+  double m_pruneMassHigh{}; /**< upper bound of the mass window for the pruning. */
+
+  std::unique_ptr<PruningIndex> m_pruningIndex; /**< index into m_store, built after preloading. */
+
+  unsigned m_checkpointInterval{0}; /**< minimal number of seconds between two checkpoints. 0 -> none. */
+
+  std::chrono::steady_clock::time_point m_lastCheckpoint; /**< time of the last checkpoint (or of enabling them). */
+
+  bool m_resumed{false}; /**< output has been opened from a checkpoint, which has not yet been used. */
+
+  bool m_failed{false}; /**< resuming from the checkpoint has been refused and the output file is closed. */
+
+  MixCheckpoint m_checkpoint; /**< the checkpoint the output has been opened from. */
+
+  /** try to open the output from a checkpoint. Returns false if there is none. */
+  bool openFromCheckpoint(const std::string& outFileName, const std::string& outTreeName);
+
+  /**
+   * set firstRow to the row at which a loop over nEvents events has to start (0 unless resumed), and mixed and
+   * trials to the values of the checkpoint. Returns false (after calling refuseResume) if the checkpoint has been
+   * written for another number of events.
+   */
+  bool startRow(const size_t nEvents, size_t& firstRow, size_t& mixed, size_t& trials);
+
+  /**
+   * print why the checkpoint can not be continued, close the output file without writing anything to it and set
+   * m_failed, so that neither a loop nor a checkpoint changes the output.
+   */
+  void refuseResume(const std::string& reason);
+
+  /**
+   * write a checkpoint if checkpoints are enabled and either force is set or the interval has passed. If force is
+   * set and checkpoints are disabled, the state is only stored with the output TTree, without writing it.
+   */
+  void checkpoint(const size_t nEvents, const size_t nextRow, const size_t mixed, const size_t trials,
+                  const bool force = false);
+
+  /** store the range of mixed input events in the output TTree (see MixManifest). */
+  void storeManifest(const uint64_t begin, const uint64_t end);
+
+  /** build the PruningIndex if pruning is enabled and it does not exist yet. */
+  void buildPruningIndex();
+
+  /**
+   * mix event i of the store with the events in [jBegin, jEnd) (output appended to out), going only through the
+   * candidates of the PruningIndex if pruning is enabled.
+   */
+  template<typename CondF, typename SinkT>
+  void mixRow(CondF& cond, const size_t i, const size_t jBegin, const size_t jEnd, SinkT& sink) const;
+
+  /**
+   * mix the pairs [pairBegin, pairEnd) (counted row by row, see trianglePair) of the in-memory store, continuing
+   * from a checkpoint if the output has been opened from one.
+   */
+  template<typename CondF>
+  void mixPairRange(CondF& cond, const uint64_t pairBegin, const uint64_t pairEnd, const std::string& logfile);
+
+  /** get the number of events to process from the maxEvents argument of the mix functions. */
+  size_t getNEvents(const long int maxEvents) const;
 };
 
 template<typename EventT, typename OutEventT>
 EventMixer<EventT, OutEventT>::EventMixer(TTree* inTree, const std::string& outFileName,
-                                          const std::string& outTreeName)
+                                          const std::string& outTreeName, const bool resume)
   : m_inTree(inTree), m_cloneInTree(clone(inTree))
 {
   m_event1.Init(m_inTree);
   m_event2.Init(m_cloneInTree);
 
+  if (resume && openFromCheckpoint(outFileName, outTreeName)) return;
+
   // init the output tree and file
   m_outFile = new TFile(outFileName.c_str(), "recreate");
   m_outTree = new TTree(outTreeName.c_str(), "mixed events tree");
@@ -106,12 +477,12 @@ void EventMixer<EventT, OutEventT>::mix(CondF cond, const long int maxEvents, co
   size_t mixed{};
   size_t trials{};
 
-  // check first how many events we want to process and correct for a possible input error, where more events
-  // then present are requested
-  const long int nInputEvents = m_inTree->GetEntries();
-  const size_t nEvents = (maxEvents < 0 || maxEvents > nInputEvents) ? nInputEvents : maxEvents;
+  if (m_failed) return;
 
+  const size_t nEvents = getNEvents(maxEvents);
   const size_t nCombinations = 0.5 * nEvents * (nEvents - 1); // we now the number of (input) combinations to check
+  size_t firstRow{};
+  if (!startRow(nEvents, firstRow, mixed, trials)) return;
 
   // open a filestream only if the progress output should be redirected to a file, otherwise use stdout
   std::ofstream filestream;
@@ -121,31 +492,745 @@ void EventMixer<EventT, OutEventT>::mix(CondF cond, const long int maxEvents, co
   std::cout << "Starting mixing of " << nEvents << " events. Possible (input) combinations: " << nCombinations << std::endl;
   auto startTime = std::chrono::high_resolution_clock::now(); // start the clock
 
-  for (size_t i = 0; i < nEvents; ++i) {
+  const size_t mixedBefore = mixed;
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  for (size_t i = firstRow; i < nEvents; ++i) {
     m_inTree->GetEntry(i);
     // second loop starts one event after the first loop! -> No mixing of the same event, and no double checking of events
     for (size_t j = i + 1; j < nEvents; ++j) {
       trials++;
       m_cloneInTree->GetEntry(j);
 
-      for (const auto& event : cond(m_event1, m_event2, i, j)) {
-        mixed++;
-        m_outEvent = event;
-        m_outTree->Fill();
-      }
+      mixTreePair(cond, m_event1, m_event2, i, j, sink);
       printProgress(trials, nCombinations, startTime, 1000, logstream); // put here to ensure that trials != 0 for all calls
     }
+    mixed = mixedBefore + sink.size();
+    checkpoint(nEvents, i + 1, mixed, trials);
   }
+  mixed = mixedBefore + sink.size();
+  if (trials == nCombinations) storeManifest(0, nEvents);
+  checkpoint(nEvents, nEvents, mixed, trials, true);
 
   std::cout << "created " << mixed << " new events from " << trials << " possible (input) combinations." << std::endl;
   if (!logfile.empty()) filestream.close(); // cannot close an unopened fstream
 }
 
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::preload(const long int maxEvents)
+{
+  const size_t nEvents = getNEvents(maxEvents);
+  if (m_store.size() == nEvents) return;
+
+  m_store.clear();
+  m_store.reserve(nEvents);
+  m_pruningIndex.reset(); // refers to the old content of the store
+
+  std::cout << "Reading " << nEvents << " events into memory" << std::endl;
+  for (size_t i = 0; i < nEvents; ++i) {
+    m_inTree->GetEntry(i);
+    m_store.add(m_event1, i);
+  }
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixInMemory(CondF cond, const long int maxEvents, const std::string& logfile)
+{
+  mixShard(cond, 0, 1, maxEvents, logfile); // the whole triangle is the only shard
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixShard(CondF cond, const unsigned shard, const unsigned nShards,
+                                             const long int maxEvents, const std::string& logfile)
+{
+  if (shard >= nShards) {
+    std::cerr << "Cannot mix shard " << shard << " of " << nShards << " shards" << std::endl;
+    return;
+  }
+  if (m_failed) return;
+
+  preload(maxEvents);
+  buildPruningIndex();
+
+  ShardInfo info;
+  info.nEvents = m_store.size();
+  info.shard = shard;
+  info.nShards = nShards;
+  const auto range = shardPairRange(info.nEvents, shard, nShards);
+  info.pairBegin = range.first;
+  info.pairEnd = range.second;
+
+  if (m_resumed) {
+    ShardInfo stored;
+    if (!stored.load(m_outTree) || stored.shard != shard || stored.nShards != nShards ||
+        stored.nEvents != info.nEvents) {
+      refuseResume("Checkpoint has not been written for shard " + std::to_string(shard) + " of " +
+                   std::to_string(nShards) + " of " + std::to_string(info.nEvents) + " events");
+      return;
+    }
+  }
+  info.store(m_outTree);
+
+  if (nShards == 1) {
+    std::cout << "Starting in-memory mixing of " << info.nEvents << " events. Possible (input) combinations: "
+              << info.pairEnd << std::endl;
+  } else {
+    std::cout << "Starting in-memory mixing of shard " << shard << " of " << nShards << " of " << info.nEvents
+              << " events. (Input) combinations in this shard: " << info.pairEnd - info.pairBegin << " (pairs "
+              << info.pairBegin << " to " << info.pairEnd << ")" << std::endl;
+  }
+  mixPairRange(cond, info.pairBegin, info.pairEnd, logfile);
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixPairRange(CondF& cond, const uint64_t pairBegin, const uint64_t pairEnd,
+                                                 const std::string& logfile)
+{
+  size_t mixed{};
+  size_t trials{};
+  const size_t nEvents = m_store.size();
+  if (pairBegin >= pairEnd) { // an empty shard is complete right away
+    checkpoint(nEvents, nEvents, mixed, trials, true);
+    return;
+  }
+
+  // the range starts and ends in the middle of a row in general
+  const auto first = trianglePair(nEvents, pairBegin);
+  const auto last = trianglePair(nEvents, pairEnd - 1);
+  size_t resumeRow{};
+  if (!startRow(nEvents, resumeRow, mixed, trials)) return;
+  const size_t firstRow = std::max(first.first, resumeRow);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+  PercentProgress<PrintStyle::ProgressText> progress(pairEnd - pairBegin, logstream);
+
+  const size_t mixedBefore = mixed;
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  for (size_t i = firstRow; i <= last.first && i < nEvents; ++i) {
+    const size_t jBegin = i == first.first ? first.second : i + 1;
+    const size_t jEnd = i == last.first ? last.second + 1 : nEvents;
+    mixRow(cond, i, jBegin, jEnd, sink);
+    trials += jEnd - jBegin;
+    mixed = mixedBefore + sink.size();
+    progress(trials);
+    checkpoint(nEvents, i + 1, mixed, trials);
+  }
+  if (pairBegin == 0 && trials == nTrianglePairs(nEvents)) storeManifest(0, nEvents);
+  checkpoint(nEvents, last.first + 1, mixed, trials, true);
+
+  std::cout << "created " << mixed << " new events from " << trials << " possible (input) combinations." << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixParallel(CondF cond, const TileSettings& settings, const long int maxEvents,
+                                                const std::string& logfile)
+{
+  size_t mixed{};
+  if (m_failed) return;
+  if (m_resumed) {
+    std::cerr << "Resuming from a checkpoint is only possible with mix, mixInMemory or mixShard" << std::endl;
+    return;
+  }
+
+  preload(maxEvents);
+  buildPruningIndex();
+  const size_t nEvents = m_store.size();
+  if (nEvents < 2) return;
+  const uint64_t nCombinations = nTrianglePairs(nEvents);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting parallel mixing of " << nEvents << " events on " << settings.nThreads
+            << " threads. Possible (input) combinations: " << nCombinations << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nCombinations, logstream);
+
+  ROOT::EnableThreadSafety(); // output events are created on the worker threads
+
+  // the candidate lookup of the pruning works per row, so do not split rows into several tiles in that case
+  TileSettings tileSettings = settings;
+  tileSettings.fullRows = tileSettings.fullRows || m_pruning;
+
+  using RecordT = typename OutputRecord<OutEventT>::type;
+  processTiledTriangle<RecordT>(nEvents, tileSettings,
+                                [this, &cond](size_t i, size_t jBegin, size_t jEnd, std::vector<RecordT>& out) {
+                                  mixRow(cond, i, jBegin, jEnd, out);
+                                },
+                                [this, &mixed](const RecordT& record) {
+                                  mixed++;
+                                  setOutput(m_outEvent, record);
+                                  fillOutput(m_outEvent, m_outTree);
+                                },
+                                progress);
+  storeManifest(0, nEvents);
+
+  std::cout << "created " << mixed << " new events from " << nCombinations << " possible (input) combinations." << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename SinkT>
+void EventMixer<EventT, OutEventT>::mixToSink(CondF cond, SinkT& sink, const long int maxEvents,
+                                              const std::string& logfile)
+{
+  if (m_failed) return;
+  preload(maxEvents);
+  buildPruningIndex();
+  const size_t nEvents = m_store.size();
+  const uint64_t nCombinations = nTrianglePairs(nEvents);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting mixing of " << nEvents << " events into a sink. Possible (input) combinations: "
+            << nCombinations << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nCombinations, logstream);
+
+  const size_t sizeBefore = sink.size();
+  uint64_t trials{};
+  for (size_t i = 0; i + 1 < nEvents; ++i) {
+    mixRow(cond, i, i + 1, nEvents, sink);
+    endRow(sink, m_store.entry(i)); // all pairs with j < i are in the previous rows
+    trials += nEvents - i - 1;
+    progress(trials);
+  }
+  if (nEvents) endRow(sink, m_store.entry(nEvents - 1));
+
+  std::cout << "created " << sink.size() - sizeBefore << " new events from " << trials
+            << " possible (input) combinations." << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixWindows(CondF cond, const std::vector<MassWindow>& windows,
+                                               const long int maxEvents, const std::string& logfile)
+{
+  if (windows.empty()) return;
+  if (m_failed) return;
+  if (m_resumed) {
+    std::cerr << "Resuming from a checkpoint is only possible with mix, mixInMemory or mixShard" << std::endl;
+    return;
+  }
+
+  // one output TTree per window instead of the one from the constructor
+  const std::string treeName = m_outTree->GetName();
+  delete m_outTree;
+  m_outTree = nullptr;
+
+  m_outFile->cd();
+  std::vector<std::unique_ptr<OutEventT> > outEvents;
+  std::vector<TreeSink<OutEventT> > sinks;
+  for (size_t k = 0; k < windows.size(); ++k) {
+    TTree* tree = new TTree((treeName + "_" + std::to_string(k)).c_str(), windowTitle(windows[k]).c_str());
+    tree->SetDirectory(m_outFile);
+    outEvents.emplace_back(new OutEventT());
+    outEvents.back()->Init(tree);
+    sinks.emplace_back(*outEvents.back(), tree);
+    m_windowTrees.push_back(tree);
+  }
+
+  std::cout << "Mixing into " << windows.size() << " mass windows:" << std::endl;
+  for (const auto& window : windows) std::cout << "  " << windowTitle(window) << std::endl;
+
+  WindowSink<TreeSink<OutEventT> > sink(windows, sinks);
+  mixToSink(cond, sink, maxEvents, logfile);
+
+  for (size_t k = 0; k < windows.size(); ++k) {
+    flushOutput(*outEvents[k], m_windowTrees[k]);
+    std::cout << "window " << windowTitle(windows[k]) << ": " << sink.sink(k).size() << " events" << std::endl;
+  }
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename SinkT>
+void EventMixer<EventT, OutEventT>::mixParallelToSink(CondF cond, SinkT& sink, const TileSettings& settings,
+                                                      const long int maxEvents, const std::string& logfile)
+{
+  if (m_failed) return;
+  preload(maxEvents);
+  buildPruningIndex();
+  const size_t nEvents = m_store.size();
+  if (nEvents < 2) return;
+  const uint64_t nCombinations = nTrianglePairs(nEvents);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting parallel mixing of " << nEvents << " events into a sink on " << settings.nThreads
+            << " threads. Possible (input) combinations: " << nCombinations << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nCombinations, logstream);
+
+  ROOT::EnableThreadSafety();
+
+  // thread-local copies, created on this thread
+  std::vector<SinkT> threadSinks;
+  threadSinks.reserve(std::max(1u, settings.nThreads));
+  for (unsigned t = 0; t < std::max(1u, settings.nThreads); ++t) threadSinks.emplace_back(sink);
+
+  // whole rows, so that a row is done once its worker is done with it
+  TileSettings tileSettings = settings;
+  tileSettings.fullRows = true;
+
+  // event k is complete once rows 0 to k are done (the last row has no pairs of its own)
+  std::mutex rowMutex;
+  std::vector<char> rowDone(nEvents);
+  rowDone[nEvents - 1] = 1;
+  size_t nEnded{};
+  processTiles(nEvents, tileSettings,
+               [&](size_t i, size_t jBegin, size_t jEnd, unsigned worker) {
+                 mixRow(cond, i, jBegin, jEnd, threadSinks[worker]);
+
+                 std::lock_guard<std::mutex> lock(rowMutex);
+                 takeOpen(sink, threadSinks[worker]);
+                 rowDone[i] = 1;
+                 while (nEnded < nEvents && rowDone[nEnded]) endRow(sink, m_store.entry(nEnded++));
+               },
+               progress);
+
+  size_t mixed{};
+  for (const auto& threadSink : threadSinks) {
+    mixed += threadSink.size();
+    sink.merge(threadSink);
+  }
+
+  std::cout << "created " << mixed << " new events from " << nCombinations << " possible (input) combinations."
+            << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixSampled(CondF cond, const PairSampling& settings, const long int maxEvents,
+                                               const std::string& logfile)
+{
+  size_t mixed{};
+  if (m_failed) return;
+  if (m_resumed) {
+    std::cerr << "Resuming from a checkpoint is only possible with mix, mixInMemory or mixShard" << std::endl;
+    return;
+  }
+
+  preload(maxEvents);
+  const size_t nEvents = m_store.size();
+  const uint64_t nCombinations = nTrianglePairs(nEvents);
+  PairSampleStream samples(nEvents, settings);
+  if (!samples.size()) return;
+
+  // inverse inclusion probability of every pair
+  const double weight = static_cast<double>(nCombinations) / samples.size();
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting mixing of " << samples.size() << " randomly sampled pairs (seed " << settings.seed
+            << ") of " << nCombinations << " possible (input) combinations of " << nEvents << " events. "
+            << "Weight per pair: " << weight << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(samples.size(), logstream);
+
+  const auto setWeight = [weight](OutEventT& event) { event.setWeight(weight); };
+  TreeSink<OutEventT, decltype(setWeight)> sink(m_outEvent, m_outTree, setWeight);
+  uint64_t trials{};
+  std::vector<uint64_t> chunk;
+  while (samples.next(chunk)) {
+    for (const uint64_t k : chunk) {
+      const auto pair = trianglePair(nEvents, k);
+      mixStoreRow(cond, m_store, pair.first, pair.second, pair.second + 1, sink);
+      progress(++trials);
+    }
+  }
+  mixed = sink.size();
+
+  std::cout << "created " << mixed << " new events from " << samples.size() << " sampled (input) combinations."
+            << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void EventMixer<EventT, OutEventT>::mixAppend(CondF cond, const std::string& previousOutput,
+                                              const long int maxEvents, const std::string& logfile)
+{
+  if (m_failed) return;
+  if (m_resumed) {
+    std::cerr << "Resuming from a checkpoint is only possible with mix, mixInMemory or mixShard" << std::endl;
+    return;
+  }
+
+  MixManifest previous;
+  TFile* prevFile = TFile::Open(previousOutput.c_str());
+  if (!prevFile || prevFile->IsZombie()) {
+    std::cerr << "Could not open \'" << previousOutput << "\'. Not mixing anything" << std::endl;
+    delete prevFile;
+    return;
+  }
+  TTree* prevTree{nullptr};
+  prevFile->GetObject(m_outTree->GetName(), prevTree);
+  const bool hasManifest = prevTree && previous.load(prevTree);
+  prevFile->Close();
+  delete prevFile;
+  if (!hasManifest) {
+    std::cerr << "\'" << previousOutput << "\' contains no information about the mixed input events (or is not "
+              << "complete). Not mixing anything" << std::endl;
+    return;
+  }
+
+  preload(maxEvents);
+  buildPruningIndex();
+  const size_t nEvents = m_store.size();
+  const size_t nOld = previous.end;
+  if (nEvents <= nOld) {
+    std::cerr << "No new input events: " << nOld << " have already been mixed, " << nEvents << " are available"
+              << std::endl;
+    return;
+  }
+  const uint64_t nCombinations = nTrianglePairs(nEvents) - nTrianglePairs(nOld);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting append mixing of " << nEvents - nOld << " new events with " << nOld
+            << " already mixed events. Possible (input) combinations: " << nCombinations << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nCombinations, logstream);
+
+  uint64_t trials{};
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  for (size_t i = 0; i + 1 < nEvents; ++i) {
+    const size_t jBegin = std::max(i + 1, nOld); // new x old for i < nOld, new x new after that
+    mixRow(cond, i, jBegin, nEvents, sink);
+    trials += nEvents - jBegin;
+    progress(trials);
+  }
+  storeManifest(nOld, nEvents);
+
+  std::cout << "created " << sink.size() << " new events from " << trials << " possible (input) combinations."
+            << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename BucketF>
+void EventMixer<EventT, OutEventT>::mixBucketed(CondF cond, BucketF bucket, const BucketSettings& settings,
+                                                const long int maxEvents, const std::string& logfile)
+{
+  if (m_failed) return;
+  if (m_resumed) {
+    std::cerr << "Resuming from a checkpoint is only possible with mix, mixInMemory or mixShard" << std::endl;
+    return;
+  }
+
+  preload(maxEvents);
+  const size_t nEvents = m_store.size();
+
+  std::vector<long> keys;
+  keys.reserve(nEvents);
+  for (size_t i = 0; i < nEvents; ++i) {
+    m_inTree->GetEntry(i);
+    keys.push_back(bucket(m_event1));
+  }
+
+  const BucketIndex index(m_store, keys);
+  const MuonStore& store = index.store();
+  const std::vector<long> offsets = BucketIndex::neighbourOffsets(settings.neighbours);
+
+  std::unique_ptr<PruningIndex> pruningIndex;
+  if (m_pruning) pruningIndex.reset(new PruningIndex(store, m_pruneMassLow, m_pruneMassHigh));
+
+  uint64_t nCombinations{};
+  for (const auto& b : index.buckets()) {
+    nCombinations += nTrianglePairs(b.size());
+    for (const long d : offsets) {
+      const auto* other = index.find(b.key + d);
+      if (other) nCombinations += uint64_t(b.size()) * other->size();
+    }
+  }
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting bucketed mixing of " << nEvents << " events in " << index.buckets().size()
+            << " buckets. Possible (input) combinations: " << nCombinations << " (instead of "
+            << nTrianglePairs(nEvents) << ")" << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nCombinations, logstream);
+
+  // per bucket combination bookkeeping
+  m_outFile->cd();
+  TTree* countTree = new TTree("bucketCounts", "mixed pairs per combination of buckets");
+  countTree->SetDirectory(m_outFile);
+  long bucketA, bucketB;
+  size_t nEventsA, nEventsB, nMixed;
+  uint64_t nPairs;
+  countTree->Branch("bucketA", &bucketA);
+  countTree->Branch("bucketB", &bucketB);
+  countTree->Branch("nEventsA", &nEventsA);
+  countTree->Branch("nEventsB", &nEventsB);
+  countTree->Branch("nPairs", &nPairs);
+  countTree->Branch("nMixed", &nMixed);
+
+  uint64_t trials{};
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  for (const auto& b : index.buckets()) {
+    size_t mixedBefore = sink.size();
+    for (size_t i = b.begin; i < b.end; ++i) {
+      mixIndexedRow(cond, store, pruningIndex.get(), i, i + 1, b.end, sink);
+    }
+    bucketA = bucketB = b.key;
+    nEventsA = nEventsB = b.size();
+    nPairs = nTrianglePairs(b.size());
+    nMixed = sink.size() - mixedBefore;
+    countTree->Fill();
+    trials += nPairs;
+
+    // the neighbours have larger keys and are hence behind b in the store, so that i < j still holds
+    for (const long d : offsets) {
+      const auto* other = index.find(b.key + d);
+      if (!other) continue;
+      mixedBefore = sink.size();
+      for (size_t i = b.begin; i < b.end; ++i) {
+        mixIndexedRow(cond, store, pruningIndex.get(), i, other->begin, other->end, sink);
+      }
+      bucketB = other->key;
+      nEventsB = other->size();
+      nPairs = uint64_t(b.size()) * other->size();
+      nMixed = sink.size() - mixedBefore;
+      countTree->Fill();
+      trials += nPairs;
+    }
+    progress(trials);
+  }
+
+  std::cout << "created " << sink.size() << " new events from " << trials << " possible (input) combinations."
+            << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename CategoryF>
+void EventMixer<EventT, OutEventT>::mixPool(CondF cond, CategoryF category, const PoolSettings& settings,
+                                            const long int maxEvents, const std::string& logfile)
+{
+  if (m_failed) return;
+  if (m_resumed) {
+    std::cerr << "Resuming from a checkpoint is only possible with mix, mixInMemory or mixShard" << std::endl;
+    return;
+  }
+
+  const size_t nEvents = getNEvents(maxEvents);
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  std::cout << "Starting pool mixing of " << nEvents << " events with a pool depth of " << settings.depth
+            << ". Maximum possible (input) combinations: " << uint64_t(nEvents) * settings.depth << std::endl;
+  PercentProgress<PrintStyle::ProgressText> progress(nEvents, logstream);
+
+  EventPool pool(settings.depth);
+  uint64_t trials{};
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  for (size_t i = 0; i < nEvents; ++i) {
+    m_inTree->GetEntry(i);
+    const auto& ring = pool.insert(category(m_event1), m_event1.muPos(), m_event1.muNeg(), i);
+
+    // mix the new event with all others in its ring
+    mixStoreRow(cond, ring.store, ring.last, 0, ring.last, sink);
+    mixStoreRow(cond, ring.store, ring.last, ring.last + 1, ring.store.size(), sink);
+    trials += ring.store.size() - 1;
+    progress(i + 1);
+  }
+
+  std::cout << "created " << sink.size() << " new events from " << trials << " possible (input) combinations in "
+            << pool.size() << " pools." << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::enablePruning(const double massLow, const double massHigh)
+{
+  m_pruning = true;
+  m_pruneMassLow = massLow;
+  m_pruneMassHigh = massHigh;
+  m_pruningIndex.reset();
+}
+
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::enableCheckpoints(const unsigned intervalSeconds)
+{
+  m_checkpointInterval = intervalSeconds;
+  m_lastCheckpoint = std::chrono::steady_clock::now();
+  // an automatic AutoSave of ROOT would write a TTree header that does not match the stored checkpoint
+  if (intervalSeconds && m_outTree) m_outTree->SetAutoSave(0);
+}
+
+template<typename EventT, typename OutEventT>
+bool EventMixer<EventT, OutEventT>::openFromCheckpoint(const std::string& outFileName,
+                                                       const std::string& outTreeName)
+{
+  std::ifstream exists(outFileName);
+  if (!exists.good()) return false;
+  exists.close();
+
+  TFile* file = TFile::Open(outFileName.c_str(), "update");
+  if (!file || file->IsZombie()) {
+    std::cerr << "Could not open \'" << outFileName << "\' for resuming. Starting from scratch" << std::endl;
+    delete file;
+    return false;
+  }
+
+  TTree* tree{nullptr};
+  file->GetObject(outTreeName.c_str(), tree);
+  MixCheckpoint state;
+  if (!tree || !state.load(tree) || state.outEntries != tree->GetEntries()) {
+    std::cerr << "No valid checkpoint in \'" << outFileName << "\'. Starting from scratch" << std::endl;
+    file->Close();
+    delete file;
+    return false;
+  }
+
+  m_outFile = file;
+  m_outTree = tree;
+  MixCheckpoint input;
+  input.setInput(m_inTree.get());
+  if (!state.sameInput(input)) {
+    refuseResume("Checkpoint in \'" + outFileName + "\' has been written for the input \'" + state.inputFiles +
+                 "\' with " + std::to_string(state.inputEntries) + " entries, but the input is \'" +
+                 input.inputFiles + "\' with " + std::to_string(input.inputEntries) + " entries");
+    return true; // do not create a new output file either
+  }
+  m_outTree->SetDirectory(m_outFile);
+  m_outEvent.Attach(m_outTree);
+
+  m_checkpoint = state;
+  m_resumed = true;
+  std::cout << "Resuming from checkpoint at row " << state.nextRow << " of " << state.nEvents << " with "
+            << state.outEntries << " events in the output" << std::endl;
+  return true;
+}
+
+template<typename EventT, typename OutEventT>
+bool EventMixer<EventT, OutEventT>::startRow(const size_t nEvents, size_t& firstRow, size_t& mixed, size_t& trials)
+{
+  firstRow = 0;
+  if (!m_resumed) return true;
+  m_resumed = false; // only the first loop can continue from the checkpoint
+
+  if (m_checkpoint.nEvents != nEvents) {
+    refuseResume("Checkpoint has been written for " + std::to_string(m_checkpoint.nEvents) + " events, but " +
+                 std::to_string(nEvents) + " are requested");
+    return false;
+  }
+
+  firstRow = m_checkpoint.nextRow;
+  mixed = m_checkpoint.mixed;
+  trials = m_checkpoint.trials;
+  return true;
+}
+
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::refuseResume(const std::string& reason)
+{
+  std::cerr << reason << ". Not resuming and leaving the output file unchanged" << std::endl;
+  m_outFile->Close(); // deletes the output TTree without writing it
+  delete m_outFile;
+  m_outFile = nullptr;
+  m_outTree = nullptr;
+  m_resumed = false;
+  m_failed = true;
+}
+
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::checkpoint(const size_t nEvents, const size_t nextRow, const size_t mixed,
+                                               const size_t trials, const bool force)
+{
+  if (!m_checkpointInterval && !force) return;
+  const auto now = std::chrono::steady_clock::now();
+  if (!force && now - m_lastCheckpoint < std::chrono::seconds(m_checkpointInterval)) return;
+
+  flushOutput(m_outEvent, m_outTree); // so that the output is complete up to nextRow
+  MixCheckpoint state;
+  state.nEvents = nEvents;
+  state.nextRow = nextRow;
+  state.mixed = mixed;
+  state.trials = trials;
+  state.outEntries = m_outTree->GetEntries();
+  state.setInput(m_inTree.get());
+  state.store(m_outTree);
+  if (!m_checkpointInterval) return; // only the record of the completed loop, written with writeToFile
+
+  // writes all baskets and the TTree header (including the checkpoint) and then the file header
+  m_outTree->AutoSave("SaveSelf;FlushBaskets");
+  m_lastCheckpoint = now;
+}
+
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::storeManifest(const uint64_t begin, const uint64_t end)
+{
+  MixManifest manifest;
+  manifest.begin = begin;
+  manifest.end = end;
+  manifest.store(m_outTree);
+}
+
+template<typename EventT, typename OutEventT>
+void EventMixer<EventT, OutEventT>::buildPruningIndex()
+{
+  if (!m_pruning || m_pruningIndex) return;
+  std::cout << "Building pruning index for " << m_pruneMassLow << " < M [GeV] < " << m_pruneMassHigh << std::endl;
+  m_pruningIndex.reset(new PruningIndex(m_store, m_pruneMassLow, m_pruneMassHigh));
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename SinkT>
+void EventMixer<EventT, OutEventT>::mixRow(CondF& cond, const size_t i, const size_t jBegin, const size_t jEnd,
+                                           SinkT& sink) const
+{
+  mixIndexedRow(cond, m_store, m_pruningIndex.get(), i, jBegin, jEnd, sink);
+}
+
+template<typename EventT, typename OutEventT>
+size_t EventMixer<EventT, OutEventT>::getNEvents(const long int maxEvents) const
+{
+  // check first how many events we want to process and correct for a possible input error, where more events
+  // then present are requested
+  const long int nInputEvents = m_inTree->GetEntries();
+  return (maxEvents < 0 || maxEvents > nInputEvents) ? nInputEvents : maxEvents;
+}
+
+template<typename EventT, typename OutEventT>
+template<typename SinkT>
+void EventMixer<EventT, OutEventT>::writeToFile(const SinkT& sink)
+{
+  if (m_failed) return;
+  delete m_outTree; // removes it from the output file, so that it is not written
+  m_outTree = nullptr;
+
+  sink.write(m_outFile);
+  m_outFile->Write();
+  m_outFile->Close();
+}
+
 template<typename EventT, typename OutEventT>
 void EventMixer<EventT, OutEventT>::writeToFile()
 {
+  if (m_failed) return;
   m_outFile->cd();
-  m_outTree->Write();
+  if (m_outTree) {
+    flushOutput(m_outEvent, m_outTree);
+    m_outTree->Write();
+  }
+  for (TTree* tree : m_windowTrees) tree->Write();
   m_outFile->Write();
   m_outFile->Close();
 }
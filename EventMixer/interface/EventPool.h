@@ -0,0 +1,67 @@
+#ifndef EVENTMIXER_EVENTPOOL_H__
+#define EVENTMIXER_EVENTPOOL_H__
+
+#include "MuonStore.h"
+
+#include "TLorentzVector.h"
+
+#include <unordered_map>
+#include <cstddef>
+
+/** Settings for the rolling event pool mixing. */
+struct PoolSettings {
+  size_t depth{10}; /**< number of most recent events of the same category every event is mixed with. */
+};
+
+/**
+ * Rolling pools of the most recent events, one per category (e.g. a bin in dimuon rapidity).
+ * Every pool is a ring buffer that holds up to depth + 1 events: the one that has been inserted last and the depth
+ * events of the same category before it. The memory needed is hence independent of the number of processed events.
+ */
+class EventPool {
+public:
+  /** one ring buffer. */
+  struct Ring {
+    MuonStore store; /**< the events in the ring. Their order is not the order of insertion. */
+    size_t last{}; /**< index of the most recently inserted event in store. */
+  };
+
+  EventPool() = delete;
+
+  EventPool(const size_t depth) : m_depth(depth) {}
+
+  /**
+   * insert an event into the pool of the passed category, replacing the oldest event of that pool if it is full.
+   * All other events in the returned ring are the (up to) depth events of the category inserted before.
+   */
+  const Ring& insert(const long category, const TLorentzVector& muPos, const TLorentzVector& muNeg,
+                     const size_t entry);
+
+  /** number of (non-empty) pools. */
+  size_t size() const { return m_rings.size(); }
+
+  size_t depth() const { return m_depth; }
+
+private:
+  size_t m_depth;
+
+  std::unordered_map<long, Ring> m_rings;
+};
+
+const EventPool::Ring& EventPool::insert(const long category, const TLorentzVector& muPos,
+                                         const TLorentzVector& muNeg, const size_t entry)
+{
+  Ring& ring = m_rings[category];
+  if (ring.store.size() <= m_depth) {
+    if (ring.store.empty()) ring.store.reserve(m_depth + 1);
+    ring.last = ring.store.size();
+    ring.store.add(muPos, muNeg, entry);
+  } else {
+    // the event after the last inserted one is the oldest
+    ring.last = (ring.last + 1) % ring.store.size();
+    ring.store.set(ring.last, muPos, muNeg, entry);
+  }
+  return ring;
+}
+
+#endif
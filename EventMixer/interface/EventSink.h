@@ -0,0 +1,184 @@
+#ifndef EVENTMIXER_EVENTSINK_H__
+#define EVENTMIXER_EVENTSINK_H__
+
+#include "TTree.h"
+
+#include <utility>
+#include <cstddef>
+
+/**
+ * Output sinks for the cond functions of the EventMixer.
+ *
+ * A sink has (a subset of) the interface of a std::vector<OutEventT>, so that a cond function can be written once
+ * for a sink and a vector:
+ * \code{.cpp}
+ * sink.emplace_back(args...); // construct the output event in place from args
+ * sink.push_back(event); // add an already existing output event
+ * \endcode
+ * For a TreeSink emplace_back writes the args directly into the branch buffers of the output TTree via
+ * OutEventT::set(args...) without creating a temporary OutEventT. OutEventT::set has to take the same arguments as
+ * the corresponding constructor and has to reset everything that is not set by them (e.g. a weight).
+ */
+
+/** does nothing to an output event. */
+struct NoDecoration {
+  template<typename T>
+  void operator()(T&) const {}
+};
+
+namespace sink_detail {
+  template<typename T>
+  struct ToVoid { using type = void; };
+
+  template<typename OutEventT>
+  auto fill(OutEventT& event, TTree* tree, int) -> decltype(event.Fill(tree), void())
+  {
+    event.Fill(tree);
+  }
+
+  template<typename OutEventT>
+  void fill(OutEventT&, TTree* tree, long)
+  {
+    tree->Fill();
+  }
+
+  template<typename OutEventT>
+  auto flush(OutEventT& event, TTree* tree, int) -> decltype(event.Flush(tree), void())
+  {
+    event.Flush(tree);
+  }
+
+  template<typename OutEventT>
+  void flush(OutEventT&, TTree*, long) {}
+
+  template<typename SinkT>
+  auto endRow(SinkT& sink, const size_t k, int) -> decltype(sink.endRow(k), void())
+  {
+    sink.endRow(k);
+  }
+
+  template<typename SinkT>
+  void endRow(SinkT&, const size_t, long) {}
+
+  template<typename SinkT>
+  auto takeOpen(SinkT& sink, SinkT& other, int) -> decltype(sink.takeOpen(other), void())
+  {
+    sink.takeOpen(other);
+  }
+
+  template<typename SinkT>
+  void takeOpen(SinkT&, SinkT&, long) {}
+}
+
+/**
+ * Write the output event (whose branch addresses are set for tree) to tree. This is tree->Fill() unless OutEventT
+ * provides Fill(TTree*), e.g. to collect several events into one entry (see ToyMCIndexOutEvent).
+ */
+template<typename OutEventT>
+inline void fillOutput(OutEventT& event, TTree* tree)
+{
+  sink_detail::fill(event, tree, 0);
+}
+
+/**
+ * Write everything that OutEventT::Fill has not yet written to tree (if OutEventT provides Flush(TTree*)).
+ * Has to be called before the output TTree is saved.
+ */
+template<typename OutEventT>
+inline void flushOutput(OutEventT& event, TTree* tree)
+{
+  sink_detail::flush(event, tree, 0);
+}
+
+/**
+ * Tell the sink that all pairs containing the input event with entry k have been put into it (if SinkT provides
+ * endRow(size_t), e.g. to fold per event information as in HistogramSink). Called by the loops of the EventMixer
+ * that write into a user provided sink (once for every input event).
+ */
+template<typename SinkT>
+inline void endRow(SinkT& sink, const size_t k)
+{
+  sink_detail::endRow(sink, k, 0);
+}
+
+/**
+ * Move the per input event information of other for the events that have not been ended yet (see endRow) into
+ * sink (if SinkT provides takeOpen(SinkT&)), so that the events can be ended in sink while other is filled on
+ * another thread (see EventMixer::mixParallelToSink).
+ */
+template<typename SinkT>
+inline void takeOpen(SinkT& sink, SinkT& other)
+{
+  sink_detail::takeOpen(sink, other, 0);
+}
+
+/**
+ * Sink that fills every event directly into the output TTree, using the OutEventT whose branch addresses are set
+ * for the TTree. decorate(OutEventT&) is called on every event just before it is filled (e.g. to set a weight).
+ */
+template<typename OutEventT, typename DecorateF = NoDecoration>
+class TreeSink {
+public:
+  TreeSink(OutEventT& event, TTree* tree, DecorateF decorate = DecorateF()) :
+    m_event(event), m_tree(tree), m_decorate(decorate) {;}
+
+  template<typename... Args>
+  void emplace_back(Args&&... args)
+  {
+    m_event.set(std::forward<Args>(args)...);
+    fill();
+  }
+
+  void push_back(const OutEventT& event)
+  {
+    m_event = event;
+    fill();
+  }
+
+  /** number of events that have been filled into the TTree. */
+  size_t size() const { return m_count; }
+
+private:
+  void fill()
+  {
+    m_decorate(m_event);
+    fillOutput(m_event, m_tree);
+    m_count++;
+  }
+
+  OutEventT& m_event;
+  TTree* m_tree;
+  DecorateF m_decorate;
+  size_t m_count{};
+};
+
+/**
+ * Type in which output events are buffered, e.g. by the worker threads of EventMixer::mixParallel.
+ * OutEventT::Record if OutEventT defines it and OutEventT otherwise. A Record is a flat copy of an output event
+ * that can be constructed from the same arguments as OutEventT and from an OutEventT, and is written with
+ * OutEventT::set(const Record&).
+ */
+template<typename OutEventT, typename = void>
+struct OutputRecord {
+  using type = OutEventT;
+};
+
+template<typename OutEventT>
+struct OutputRecord<OutEventT, typename sink_detail::ToVoid<typename OutEventT::Record>::type> {
+  using type = typename OutEventT::Record;
+};
+
+/** set the output event from a buffered one. */
+template<typename OutEventT>
+inline void setOutput(OutEventT& out, const OutEventT& event)
+{
+  out = event;
+}
+
+template<typename OutEventT, typename RecordT>
+inline void setOutput(OutEventT& out, const RecordT& record)
+{
+  out.set(record);
+}
+
+#endif
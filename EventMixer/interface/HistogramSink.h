@@ -0,0 +1,272 @@
+#ifndef EVENTMIXER_HISTOGRAMSINK_H__
+#define EVENTMIXER_HISTOGRAMSINK_H__
+
+#include "BinCovariance.h"
+#include "PolUtils/interface/calcAngles.h"
+
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TDirectory.h"
+#include "TLorentzVector.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+#include <cstddef>
+
+/** variables of a mixed event that can be histogrammed by a HistogramSink. */
+enum class PairVariable {
+  Mass, /**< dimuon mass. */
+  Pt, /**< dimuon pT. */
+  Rapidity, /**< dimuon rapidity. */
+  CosThHX, /**< cos theta of the positive muon in the helicity frame. */
+  PhiHX, /**< phi (in degrees) of the positive muon in the helicity frame. */
+  CosThCS, /**< cos theta of the positive muon in the Collins-Soper frame. */
+  PhiCS /**< phi (in degrees) of the positive muon in the Collins-Soper frame. */
+};
+
+/** binning of one axis of a histogram of a PairVariable. */
+struct HistAxis {
+  PairVariable var;
+  int nBins;
+  double min;
+  double max;
+};
+
+/** definition of a 1D (only x) or 2D (x and y) histogram of a HistogramSink. */
+struct HistDef {
+  HistDef(const std::string& n, const HistAxis& xAxis) : name(n), x(xAxis), twoD(false) {;}
+
+  HistDef(const std::string& n, const HistAxis& xAxis, const HistAxis& yAxis) :
+    name(n), x(xAxis), y(yAxis), twoD(true) {;}
+
+  std::string name;
+  HistAxis x;
+  HistAxis y{PairVariable::Mass, 1, 0, 1};
+  bool twoD;
+};
+
+/**
+ * Values of the PairVariables of one mixed event, where the angles are only calculated (once per frame) if they
+ * are needed.
+ */
+class PairValues {
+public:
+  PairValues(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon) :
+    m_muPos(muPos), m_muNeg(muNeg), m_dimuon(dimuon) {;}
+
+  double get(const PairVariable var);
+
+private:
+  const Angles& angles(const RefFrame frame);
+
+  const TLorentzVector& m_muPos;
+  const TLorentzVector& m_muNeg;
+  const TLorentzVector& m_dimuon;
+
+  Angles m_anglesHX;
+  Angles m_anglesCS;
+  bool m_hasHX{false};
+  bool m_hasCS{false};
+};
+
+double PairValues::get(const PairVariable var)
+{
+  switch (var) {
+  case PairVariable::Mass: return m_dimuon.M();
+  case PairVariable::Pt: return m_dimuon.Pt();
+  case PairVariable::Rapidity: return m_dimuon.Rapidity();
+  case PairVariable::CosThHX: return angles(RefFrame::HX).costh;
+  case PairVariable::PhiHX: return angles(RefFrame::HX).phi;
+  case PairVariable::CosThCS: return angles(RefFrame::CS).costh;
+  case PairVariable::PhiCS: return angles(RefFrame::CS).phi;
+  }
+  return 0;
+}
+
+const Angles& PairValues::angles(const RefFrame frame)
+{
+  if (frame == RefFrame::HX) {
+    if (!m_hasHX) m_anglesHX = calcAnglesInFrame(m_muNeg, m_muPos, RefFrame::HX);
+    m_hasHX = true;
+    return m_anglesHX;
+  }
+  if (!m_hasCS) m_anglesCS = calcAnglesInFrame(m_muNeg, m_muPos, RefFrame::CS);
+  m_hasCS = true;
+  return m_anglesCS;
+}
+
+/**
+ * Sink (see EventSink.h) that fills the mixed events directly into a set of histograms instead of writing them to
+ * a TTree. It takes the same arguments in emplace_back as ToyMCOutEvent::set (the indices and flags are ignored).
+ * All events are filled with the weight set by setWeight (default 1).
+ *
+ * The histograms are not attached to any TDirectory. A copy of a HistogramSink has its own (empty) histograms
+ * with the same definitions, so that copies can be filled on different threads and combined with merge at the
+ * end (see EventMixer::mixParallelToSink).
+ *
+ * For histograms for which enableCovariance has been called, the bin-bin covariance is estimated while filling
+ * (see BinCovariance), using the indices i and j passed to emplace_back as input events. The EventMixer calls
+ * endRow(k) once all pairs with input event k have been filled. The covariance is written as TH2D <name>_cov over
+ * the global bin numbers (including under- and overflow) of the histogram.
+ */
+class HistogramSink {
+public:
+  HistogramSink() = delete;
+
+  HistogramSink(const std::vector<HistDef>& defs);
+
+  /** create empty histograms (and covariances) with the definitions of other. */
+  HistogramSink(const HistogramSink& other);
+
+  HistogramSink& operator=(const HistogramSink&) = delete;
+
+  void emplace_back(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+                    unsigned i = 0, unsigned j = 0, unsigned flags = 0);
+
+  /** estimate the covariance of the bins of the histogram with the passed name. Call before filling. */
+  void enableCovariance(const std::string& name);
+
+  /** all pairs containing input event k have been filled. */
+  void endRow(const size_t k);
+
+  /** move the contributions to the covariances of the events that have not been ended from other into this. */
+  void takeOpen(HistogramSink& other);
+
+  /** set the weight for all following events. */
+  void setWeight(const double w) { m_weight = w; }
+
+  /** add the content of other (which has to have the same definitions) to this. */
+  void merge(const HistogramSink& other);
+
+  /** number of filled events. */
+  size_t size() const { return m_count; }
+
+  /** get the histogram with the passed name or nullptr. */
+  const TH1* get(const std::string& name) const;
+
+  /** write all histograms to the directory. */
+  void write(TDirectory* dir) const;
+
+private:
+  std::vector<HistDef> m_defs;
+
+  std::vector<std::unique_ptr<TH1> > m_hists;
+
+  std::vector<std::unique_ptr<BinCovariance> > m_covs; /**< nullptr if not enabled for a histogram. */
+
+  double m_weight{1};
+
+  size_t m_count{};
+};
+
+HistogramSink::HistogramSink(const std::vector<HistDef>& defs) : m_defs(defs)
+{
+  for (const auto& def : m_defs) {
+    TH1* h{nullptr};
+    if (def.twoD) {
+      h = new TH2D(def.name.c_str(), "", def.x.nBins, def.x.min, def.x.max, def.y.nBins, def.y.min, def.y.max);
+    } else {
+      h = new TH1D(def.name.c_str(), "", def.x.nBins, def.x.min, def.x.max);
+    }
+    h->SetDirectory(nullptr);
+    h->Sumw2();
+    m_hists.emplace_back(h);
+    m_covs.emplace_back(nullptr);
+  }
+}
+
+HistogramSink::HistogramSink(const HistogramSink& other) : HistogramSink(other.m_defs)
+{
+  for (size_t k = 0; k < m_defs.size(); ++k) {
+    if (other.m_covs[k]) m_covs[k].reset(new BinCovariance(other.m_covs[k]->nBins()));
+  }
+}
+
+void HistogramSink::enableCovariance(const std::string& name)
+{
+  for (size_t k = 0; k < m_defs.size(); ++k) {
+    if (m_defs[k].name != name) continue;
+    const HistDef& def = m_defs[k];
+    const size_t nCells = def.twoD ? (def.x.nBins + 2) * (def.y.nBins + 2) : def.x.nBins + 2;
+    m_covs[k].reset(new BinCovariance(nCells));
+    return;
+  }
+  std::cerr << "No histogram \'" << name << "\' for estimating the covariance" << std::endl;
+}
+
+void HistogramSink::endRow(const size_t k)
+{
+  for (auto& cov : m_covs) {
+    if (cov) cov->fold(k);
+  }
+}
+
+void HistogramSink::takeOpen(HistogramSink& other)
+{
+  for (size_t k = 0; k < m_covs.size(); ++k) {
+    if (m_covs[k] && other.m_covs[k]) m_covs[k]->take(*other.m_covs[k]);
+  }
+}
+
+void HistogramSink::emplace_back(const TLorentzVector& muPos, const TLorentzVector& muNeg,
+                                 const TLorentzVector& dimuon, unsigned i, unsigned j, unsigned)
+{
+  PairValues values(muPos, muNeg, dimuon);
+  for (size_t k = 0; k < m_defs.size(); ++k) {
+    const HistDef& def = m_defs[k];
+    int bin;
+    if (def.twoD) {
+      bin = static_cast<TH2*>(m_hists[k].get())->Fill(values.get(def.x.var), values.get(def.y.var), m_weight);
+    } else {
+      bin = m_hists[k]->Fill(values.get(def.x.var), m_weight);
+    }
+    if (m_covs[k]) {
+      m_covs[k]->add(i, bin, m_weight);
+      m_covs[k]->add(j, bin, m_weight);
+    }
+  }
+  m_count++;
+}
+
+void HistogramSink::merge(const HistogramSink& other)
+{
+  if (other.m_hists.size() != m_hists.size()) {
+    std::cerr << "Cannot merge HistogramSinks with different histograms" << std::endl;
+    return;
+  }
+  for (size_t k = 0; k < m_hists.size(); ++k) {
+    m_hists[k]->Add(other.m_hists[k].get());
+    if (m_covs[k] && other.m_covs[k]) m_covs[k]->merge(*other.m_covs[k]);
+  }
+  m_count += other.m_count;
+}
+
+const TH1* HistogramSink::get(const std::string& name) const
+{
+  for (size_t k = 0; k < m_defs.size(); ++k) {
+    if (m_defs[k].name == name) return m_hists[k].get();
+  }
+  return nullptr;
+}
+
+void HistogramSink::write(TDirectory* dir) const
+{
+  dir->cd();
+  for (const auto& h : m_hists) dir->WriteTObject(h.get());
+
+  for (size_t k = 0; k < m_defs.size(); ++k) {
+    if (!m_covs[k]) continue;
+    const size_t n = m_covs[k]->nBins();
+    const std::vector<double> cov = m_covs[k]->matrix();
+    TH2D hCov((m_defs[k].name + "_cov").c_str(), ";global bin;global bin", n, -0.5, n - 0.5, n, -0.5, n - 0.5);
+    hCov.SetDirectory(nullptr);
+    for (size_t a = 0; a < n; ++a) {
+      for (size_t b = 0; b < n; ++b) hCov.SetBinContent(a + 1, b + 1, cov[a * n + b]);
+    }
+    dir->WriteTObject(&hCov);
+  }
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef EVENTMIXER_MASSWINDOWKERNEL_H__
+#define EVENTMIXER_MASSWINDOWKERNEL_H__
+
+#include "MuonStore.h"
+
+// the vectorized kernels are compiled for their instruction sets with target attributes and chosen at runtime, so
+// that the binary does not need to be built for the machine it runs on
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define EVENTMIXER_MASSKERNEL_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+/** maximum number of partners that can be tested in one call of massWindowMask. */
+constexpr size_t massKernelBlock = 64;
+
+/**
+ * Squared mass window used as a pre-filter in front of the exact mass check.
+ * Bounds are widened by a small relative amount, such that a pair passing (massLow, massHigh) in the exact
+ * TLorentzVector::M() check never fails the M^2 test because of rounding.
+ */
+struct SquaredMassWindow {
+  SquaredMassWindow(const double massLow, const double massHigh);
+
+  double low;
+  double high;
+};
+
+SquaredMassWindow::SquaredMassWindow(const double massLow, const double massHigh)
+{
+  constexpr double relTol = 1e-9;
+  low = massLow > 0 ? massLow * massLow * (1 - relTol) : -std::numeric_limits<double>::infinity();
+  high = massHigh > 0 ? massHigh * massHigh * (1 + relTol) : 0;
+}
+
+namespace kernel_detail {
+  /** signature of the kernels of massWindowMask (with the columns already offset to the first partner). */
+  using MassKernel = uint64_t (*)(const double px, const double py, const double pz, const double E,
+                                  const double* cpx, const double* cpy, const double* cpz, const double* cE,
+                                  const size_t n, const double low, const double high);
+
+  /** plain loop over the partners [k, n), adding to mask. */
+  inline uint64_t massMaskScalar(const double px, const double py, const double pz, const double E,
+                                 const double* cpx, const double* cpy, const double* cpz, const double* cE,
+                                 size_t k, const size_t n, const double low, const double high, uint64_t mask)
+  {
+    for (; k < n; ++k) {
+      const double sx = px + cpx[k];
+      const double sy = py + cpy[k];
+      const double sz = pz + cpz[k];
+      const double se = E + cE[k];
+      const double m2 = se * se - (sx * sx + sy * sy + sz * sz);
+      mask |= static_cast<uint64_t>(m2 > low && m2 < high) << k;
+    }
+    return mask;
+  }
+
+  inline uint64_t massMaskPlain(const double px, const double py, const double pz, const double E,
+                                const double* cpx, const double* cpy, const double* cpz, const double* cE,
+                                const size_t n, const double low, const double high)
+  {
+    return massMaskScalar(px, py, pz, E, cpx, cpy, cpz, cE, 0, n, low, high, 0);
+  }
+
+#ifdef EVENTMIXER_MASSKERNEL_DISPATCH
+  __attribute__((target("avx512f")))
+  inline uint64_t massMaskAVX512(const double px, const double py, const double pz, const double E,
+                                 const double* cpx, const double* cpy, const double* cpz, const double* cE,
+                                 const size_t n, const double low, const double high)
+  {
+    uint64_t mask{};
+    size_t k{};
+    const __m512d vpx = _mm512_set1_pd(px);
+    const __m512d vpy = _mm512_set1_pd(py);
+    const __m512d vpz = _mm512_set1_pd(pz);
+    const __m512d vE = _mm512_set1_pd(E);
+    const __m512d vLow = _mm512_set1_pd(low);
+    const __m512d vHigh = _mm512_set1_pd(high);
+    for (; k + 8 <= n; k += 8) {
+      const __m512d sx = _mm512_add_pd(vpx, _mm512_loadu_pd(cpx + k));
+      const __m512d sy = _mm512_add_pd(vpy, _mm512_loadu_pd(cpy + k));
+      const __m512d sz = _mm512_add_pd(vpz, _mm512_loadu_pd(cpz + k));
+      const __m512d se = _mm512_add_pd(vE, _mm512_loadu_pd(cE + k));
+      const __m512d p2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(sx, sx), _mm512_mul_pd(sy, sy)),
+                                       _mm512_mul_pd(sz, sz));
+      const __m512d m2 = _mm512_sub_pd(_mm512_mul_pd(se, se), p2);
+      const __mmask8 inWindow = _mm512_cmp_pd_mask(m2, vLow, _CMP_GT_OQ) & _mm512_cmp_pd_mask(m2, vHigh, _CMP_LT_OQ);
+      mask |= static_cast<uint64_t>(inWindow) << k;
+    }
+    return massMaskScalar(px, py, pz, E, cpx, cpy, cpz, cE, k, n, low, high, mask);
+  }
+
+  __attribute__((target("avx2")))
+  inline uint64_t massMaskAVX2(const double px, const double py, const double pz, const double E,
+                               const double* cpx, const double* cpy, const double* cpz, const double* cE,
+                               const size_t n, const double low, const double high)
+  {
+    uint64_t mask{};
+    size_t k{};
+    const __m256d vpx = _mm256_set1_pd(px);
+    const __m256d vpy = _mm256_set1_pd(py);
+    const __m256d vpz = _mm256_set1_pd(pz);
+    const __m256d vE = _mm256_set1_pd(E);
+    const __m256d vLow = _mm256_set1_pd(low);
+    const __m256d vHigh = _mm256_set1_pd(high);
+    for (; k + 4 <= n; k += 4) {
+      const __m256d sx = _mm256_add_pd(vpx, _mm256_loadu_pd(cpx + k));
+      const __m256d sy = _mm256_add_pd(vpy, _mm256_loadu_pd(cpy + k));
+      const __m256d sz = _mm256_add_pd(vpz, _mm256_loadu_pd(cpz + k));
+      const __m256d se = _mm256_add_pd(vE, _mm256_loadu_pd(cE + k));
+      const __m256d p2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sx, sx), _mm256_mul_pd(sy, sy)),
+                                       _mm256_mul_pd(sz, sz));
+      const __m256d m2 = _mm256_sub_pd(_mm256_mul_pd(se, se), p2);
+      const __m256d inWindow = _mm256_and_pd(_mm256_cmp_pd(m2, vLow, _CMP_GT_OQ),
+                                             _mm256_cmp_pd(m2, vHigh, _CMP_LT_OQ));
+      mask |= static_cast<uint64_t>(_mm256_movemask_pd(inWindow)) << k;
+    }
+    return massMaskScalar(px, py, pz, E, cpx, cpy, cpz, cE, k, n, low, high, mask);
+  }
+#endif
+
+  /** the fastest kernel that the CPU the program is running on supports. */
+  inline MassKernel selectMassKernel()
+  {
+#ifdef EVENTMIXER_MASSKERNEL_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return massMaskAVX512;
+    if (__builtin_cpu_supports("avx2")) return massMaskAVX2;
+#endif
+    return massMaskPlain;
+  }
+}
+
+/**
+ * Test the muon (px, py, pz, E) against the muons [begin, begin + n) in cols (n <= massKernelBlock) and return a
+ * bitmask with bit k set if the squared invariant mass of the pair with muon begin + k is inside (window.low,
+ * window.high). Uses AVX-512 or AVX2 if the CPU supports it (checked once at runtime) and plain loops otherwise.
+ */
+inline uint64_t massWindowMask(const double px, const double py, const double pz, const double E,
+                               const FourMomColumns& cols, const size_t begin, const size_t n,
+                               const SquaredMassWindow& window)
+{
+  static const kernel_detail::MassKernel kernel = kernel_detail::selectMassKernel();
+  return kernel(px, py, pz, E, cols.px.data() + begin, cols.py.data() + begin, cols.pz.data() + begin,
+                cols.E.data() + begin, n, window.low, window.high);
+}
+
+#endif
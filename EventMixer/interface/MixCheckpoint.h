@@ -0,0 +1,105 @@
+#ifndef EVENTMIXER_MIXCHECKPOINT_H__
+#define EVENTMIXER_MIXCHECKPOINT_H__
+
+#include "TreeUserInfo.h"
+
+#include "TTree.h"
+#include "TChain.h"
+#include "TFile.h"
+
+#include <string>
+#include <cstddef>
+
+/**
+ * State of a row-wise mixing loop that has been written together with the output TTree.
+ *
+ * The state is kept in the UserInfo of the output TTree, so that it is written in the same TTree::AutoSave as
+ * the TTree header and always describes exactly the entries that are stored in the file. All rows before nextRow
+ * are completely mixed and their output is in the TTree.
+ * The input the checkpoint has been written for is identified by the names of its files and its number of entries,
+ * so that a checkpoint is not continued with another input.
+ */
+struct MixCheckpoint {
+  size_t nEvents{}; /**< number of input events that are mixed. */
+  size_t nextRow{}; /**< first row i that has not been mixed yet. */
+  size_t mixed{}; /**< number of created output events. */
+  size_t trials{}; /**< number of checked (input) combinations. */
+  Long64_t outEntries{}; /**< number of entries in the output TTree. */
+  std::string inputFiles; /**< names of the input files, separated by ';'. */
+  Long64_t inputEntries{}; /**< number of entries in the input TTree (not only the mixed ones). */
+
+  /** set inputFiles and inputEntries from the input TTree (or TChain). */
+  void setInput(TTree* inTree);
+
+  /** true if other has been written for the same input (same inputFiles and inputEntries). */
+  bool sameInput(const MixCheckpoint& other) const;
+
+  /** put the state into the UserInfo of the tree (overwriting a previous state). */
+  void store(TTree* tree) const;
+
+  /** read the state from the UserInfo of the tree. Returns false if the tree has no (complete) state. */
+  bool load(TTree* tree);
+};
+
+namespace checkpoint_detail {
+  /** name prefix of the values in the UserInfo. */
+  const std::string prefix = "mixCheckpoint_";
+}
+
+void MixCheckpoint::store(TTree* tree) const
+{
+  using checkpoint_detail::prefix;
+  setUserInfoValue(tree, prefix + "nEvents", nEvents);
+  setUserInfoValue(tree, prefix + "nextRow", nextRow);
+  setUserInfoValue(tree, prefix + "mixed", mixed);
+  setUserInfoValue(tree, prefix + "trials", trials);
+  setUserInfoValue(tree, prefix + "outEntries", outEntries);
+  setUserInfoString(tree, prefix + "inputFiles", inputFiles);
+  setUserInfoValue(tree, prefix + "inputEntries", inputEntries);
+}
+
+bool MixCheckpoint::load(TTree* tree)
+{
+  using checkpoint_detail::prefix;
+  Long64_t events, row, mix, trial, entries, inEntries;
+  std::string files;
+  if (!getUserInfoValue(tree, prefix + "nEvents", events) || !getUserInfoValue(tree, prefix + "nextRow", row) ||
+      !getUserInfoValue(tree, prefix + "mixed", mix) || !getUserInfoValue(tree, prefix + "trials", trial) ||
+      !getUserInfoValue(tree, prefix + "outEntries", entries) ||
+      !getUserInfoString(tree, prefix + "inputFiles", files) ||
+      !getUserInfoValue(tree, prefix + "inputEntries", inEntries)) {
+    return false;
+  }
+
+  nEvents = events;
+  nextRow = row;
+  mixed = mix;
+  trials = trial;
+  outEntries = entries;
+  inputFiles = files;
+  inputEntries = inEntries;
+  return true;
+}
+
+void MixCheckpoint::setInput(TTree* inTree)
+{
+  inputFiles.clear();
+  const TChain* chain = dynamic_cast<const TChain*>(inTree);
+  if (chain) {
+    const TObjArray* files = chain->GetListOfFiles();
+    for (int i = 0; i < files->GetEntries(); ++i) {
+      if (i) inputFiles += ";";
+      inputFiles += static_cast<const TNamed*>(files->At(i))->GetTitle(); // TChainElement title is the file name
+    }
+  } else if (inTree->GetCurrentFile()) {
+    inputFiles = inTree->GetCurrentFile()->GetName();
+  }
+  inputEntries = inTree->GetEntries();
+}
+
+bool MixCheckpoint::sameInput(const MixCheckpoint& other) const
+{
+  return inputFiles == other.inputFiles && inputEntries == other.inputEntries;
+}
+
+#endif
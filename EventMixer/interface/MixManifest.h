@@ -0,0 +1,55 @@
+#ifndef EVENTMIXER_MIXMANIFEST_H__
+#define EVENTMIXER_MIXMANIFEST_H__
+
+#include "TreeUserInfo.h"
+
+#include "TTree.h"
+
+#include <string>
+#include <cstdint>
+
+/**
+ * Which input events have been mixed into an output file, stored in the UserInfo of the output TTree once the
+ * mixing is complete (by EventMixer::mix, mixInMemory, mixParallel and mixAppend, and by mergeShards).
+ * The output contains all pairs i < j with begin <= j < end, i.e. a complete mixing of the first N input events
+ * has begin = 0 and end = N, and an append run (see EventMixer::mixAppend) that adds the events [N, M) to it has
+ * begin = N and end = M. A chain of outputs whose ranges are contiguous and start at 0 is the same as a complete
+ * mixing of all events (up to the order of the output).
+ */
+struct MixManifest {
+  uint64_t begin{}; /**< first input event that is mixed with all events before it. */
+  uint64_t end{}; /**< one past the last mixed input event. */
+
+  /** put the information into the UserInfo of the tree (overwriting previous information). */
+  void store(TTree* tree) const;
+
+  /** read the information from the UserInfo of the tree. Returns false if it is not (completely) there. */
+  bool load(TTree* tree);
+};
+
+namespace manifest_detail {
+  /** name prefix of the values in the UserInfo. */
+  const std::string prefix = "mixManifest_";
+}
+
+void MixManifest::store(TTree* tree) const
+{
+  using manifest_detail::prefix;
+  setUserInfoValue(tree, prefix + "begin", begin);
+  setUserInfoValue(tree, prefix + "end", end);
+}
+
+bool MixManifest::load(TTree* tree)
+{
+  using manifest_detail::prefix;
+  Long64_t first, last;
+  if (!getUserInfoValue(tree, prefix + "begin", first) || !getUserInfoValue(tree, prefix + "end", last)) {
+    return false;
+  }
+
+  begin = first;
+  end = last;
+  return true;
+}
+
+#endif
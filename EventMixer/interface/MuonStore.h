@@ -0,0 +1,140 @@
+#ifndef EVENTMIXER_MUONSTORE_H__
+#define EVENTMIXER_MUONSTORE_H__
+
+#include "TLorentzVector.h"
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Four-momenta stored in structure-of-arrays layout.
+ * Every component lives in its own contiguous column, so that loops over many four-momenta touch only the
+ * memory they need and can be vectorized by the compiler.
+ */
+struct FourMomColumns {
+  std::vector<double> px;
+  std::vector<double> py;
+  std::vector<double> pz;
+  std::vector<double> E;
+
+  void reserve(const size_t n);
+
+  void push_back(const TLorentzVector& p);
+
+  /** overwrite the four-momentum at index i. */
+  void set(const size_t i, const TLorentzVector& p);
+
+  void clear();
+
+  size_t size() const { return E.size(); }
+
+  /** rebuild the TLorentzVector at index i. */
+  TLorentzVector get(const size_t i) const { return TLorentzVector(px[i], py[i], pz[i], E[i]); }
+};
+
+void FourMomColumns::reserve(const size_t n)
+{
+  px.reserve(n);
+  py.reserve(n);
+  pz.reserve(n);
+  E.reserve(n);
+}
+
+void FourMomColumns::push_back(const TLorentzVector& p)
+{
+  px.push_back(p.Px());
+  py.push_back(p.Py());
+  pz.push_back(p.Pz());
+  E.push_back(p.E());
+}
+
+void FourMomColumns::set(const size_t i, const TLorentzVector& p)
+{
+  px[i] = p.Px();
+  py[i] = p.Py();
+  pz[i] = p.Pz();
+  E[i] = p.E();
+}
+
+void FourMomColumns::clear()
+{
+  px.clear();
+  py.clear();
+  pz.clear();
+  E.clear();
+}
+
+/**
+ * In-memory copy of the muon kinematics of (a range of) the events in an input TTree.
+ * The positive and the negative muons are stored in separate columns. Index k in the store belongs to the
+ * event that was read from entry(k) of the input TTree, so that output events can still refer to the input.
+ */
+class MuonStore {
+public:
+  MuonStore() = default;
+
+  void reserve(const size_t n);
+
+  /** append an event with the passed muons, that has been read from the passed entry of the input TTree. */
+  void add(const TLorentzVector& muPos, const TLorentzVector& muNeg, const size_t entry);
+
+  /** append an event that provides muPos() and muNeg(). */
+  template<typename EventT>
+  void add(const EventT& event, const size_t entry) { add(event.muPos(), event.muNeg(), entry); }
+
+  /** overwrite the event at index k (e.g. to use the store as a ring buffer). */
+  void set(const size_t k, const TLorentzVector& muPos, const TLorentzVector& muNeg, const size_t entry);
+
+  void clear();
+
+  size_t size() const { return m_entries.size(); }
+
+  bool empty() const { return m_entries.empty(); }
+
+  const FourMomColumns& pos() const { return m_pos; }
+
+  const FourMomColumns& neg() const { return m_neg; }
+
+  /** entry in the input TTree of the event at index k. */
+  size_t entry(const size_t k) const { return m_entries[k]; }
+
+  /** memory needed per stored event (in bytes). */
+  static constexpr size_t bytesPerEvent() { return 8 * sizeof(double) + sizeof(size_t); }
+
+private:
+  FourMomColumns m_pos; /**< positive muons. */
+
+  FourMomColumns m_neg; /**< negative muons. */
+
+  std::vector<size_t> m_entries; /**< entries in the input TTree. */
+};
+
+void MuonStore::reserve(const size_t n)
+{
+  m_pos.reserve(n);
+  m_neg.reserve(n);
+  m_entries.reserve(n);
+}
+
+void MuonStore::add(const TLorentzVector& muPos, const TLorentzVector& muNeg, const size_t entry)
+{
+  m_pos.push_back(muPos);
+  m_neg.push_back(muNeg);
+  m_entries.push_back(entry);
+}
+
+void MuonStore::set(const size_t k, const TLorentzVector& muPos, const TLorentzVector& muNeg, const size_t entry)
+{
+  m_pos.set(k, muPos);
+  m_neg.set(k, muNeg);
+  m_entries[k] = entry;
+}
+
+void MuonStore::clear()
+{
+  m_pos.clear();
+  m_neg.clear();
+  m_entries.clear();
+}
+
+#endif
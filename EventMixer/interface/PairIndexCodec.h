@@ -0,0 +1,110 @@
+#ifndef EVENTMIXER_PAIRINDEXCODEC_H__
+#define EVENTMIXER_PAIRINDEXCODEC_H__
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/** The indices of the two input events (and the flags) that define a mixed event. */
+struct PairIndex {
+  unsigned posEvent; /**< entry of the event of the positive muon in the input TTree. */
+  unsigned negEvent; /**< entry of the event of the negative muon in the input TTree. */
+  unsigned flags;
+
+  bool operator<(const PairIndex& other) const
+  {
+    return posEvent < other.posEvent || (posEvent == other.posEvent && negEvent < other.negEvent);
+  }
+};
+
+/** maximum number of bytes needed for one encoded PairIndex (three 32 bit varints). */
+constexpr size_t maxPairIndexBytes = 15;
+
+/** append v as LEB128 varint (7 bits per byte, lowest first) to out and return the new end of out. */
+inline unsigned char* putVarint(uint64_t v, unsigned char* out)
+{
+  while (v >= 0x80) {
+    *out++ = static_cast<unsigned char>(v | 0x80);
+    v >>= 7;
+  }
+  *out++ = static_cast<unsigned char>(v);
+  return out;
+}
+
+/** read a varint from [in, end) into v and advance in. Returns false if the input ends in the varint. */
+inline bool getVarint(const unsigned char*& in, const unsigned char* end, uint64_t& v)
+{
+  v = 0;
+  for (unsigned shift = 0; in != end && shift < 64; shift += 7) {
+    const unsigned char byte = *in++;
+    v |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+/** map signed to unsigned integers, such that values close to 0 get small varints. */
+inline uint64_t zigzag(const int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+
+inline int64_t unzigzag(const uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+/**
+ * Sort pairs and encode them into out, which has to hold at least maxPairIndexBytes * pairs.size() bytes.
+ * Returns the number of bytes written.
+ *
+ * Every pair is stored as varints: the difference of posEvent to the previous pair, then negEvent as difference
+ * to the previous negEvent if posEvent is the same, and as (zigzag encoded) difference to posEvent otherwise,
+ * and finally the flags. For the sorted pairs of a mixing loop most pairs need 3 to 5 bytes.
+ */
+size_t encodePairBlock(std::vector<PairIndex>& pairs, unsigned char* out)
+{
+  std::sort(pairs.begin(), pairs.end());
+
+  unsigned char* begin = out;
+  unsigned prevPos{};
+  unsigned prevNeg{};
+  for (size_t k = 0; k < pairs.size(); ++k) {
+    const PairIndex& pair = pairs[k];
+    out = putVarint(pair.posEvent - prevPos, out);
+    if (k && pair.posEvent == prevPos) {
+      out = putVarint(pair.negEvent - prevNeg, out);
+    } else {
+      out = putVarint(zigzag(int64_t(pair.negEvent) - int64_t(pair.posEvent)), out);
+    }
+    out = putVarint(pair.flags, out);
+    prevPos = pair.posEvent;
+    prevNeg = pair.negEvent;
+  }
+
+  return out - begin;
+}
+
+/** decode nPairs pairs from the nBytes in bytes (written by encodePairBlock). Returns false for corrupt input. */
+bool decodePairBlock(const unsigned char* bytes, const size_t nBytes, const size_t nPairs,
+                     std::vector<PairIndex>& pairs)
+{
+  pairs.clear();
+  pairs.reserve(nPairs);
+
+  const unsigned char* end = bytes + nBytes;
+  uint64_t dPos, neg, flags;
+  for (size_t k = 0; k < nPairs; ++k) {
+    if (!getVarint(bytes, end, dPos) || !getVarint(bytes, end, neg) || !getVarint(bytes, end, flags)) {
+      return false;
+    }
+    PairIndex pair;
+    pair.posEvent = (k ? pairs.back().posEvent : 0) + dPos;
+    if (k && dPos == 0) {
+      pair.negEvent = pairs.back().negEvent + neg;
+    } else {
+      pair.negEvent = int64_t(pair.posEvent) + unzigzag(neg);
+    }
+    pair.flags = flags;
+    pairs.push_back(pair);
+  }
+
+  return bytes == end;
+}
+
+#endif
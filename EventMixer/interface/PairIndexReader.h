@@ -0,0 +1,192 @@
+#ifndef EVENTMIXER_PAIRINDEXREADER_H__
+#define EVENTMIXER_PAIRINDEXREADER_H__
+
+#include "PairIndexCodec.h"
+#include "MuonStore.h"
+
+#include "TTree.h"
+#include "TLorentzVector.h"
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Reader for the output written with ToyMCIndexOutEvent, that rebuilds the four-momenta of the mixed events
+ * lazily from the input TTree of the mixing.
+ *
+ * GetEntry(k) gets the k-th mixed event (counting the pairs in all blocks). Only the block containing it is
+ * decoded (and kept until another block is needed), and the input events are read in chunks of cacheEvents
+ * consecutive entries into MuonStores, of which the cacheChunks most recently used ones are kept. Since the
+ * pairs are sorted in every block, reading the events in order touches every input chunk only a few times.
+ *
+ * EventT has the same requirements as for EventMixer::preload (Init(TTree*), muPos() and muNeg()).
+ * Cross mixed output (see CrossEventMixer) refers to two input TTrees and can not be read with this.
+ */
+template<typename EventT>
+class PairIndexReader {
+public:
+  PairIndexReader() = delete;
+
+  PairIndexReader(TTree* indexTree, TTree* inputTree, const size_t cacheEvents = 4096,
+                  const size_t cacheChunks = 16);
+
+  /** total number of mixed events. */
+  uint64_t size() const { return m_blockBegin.back(); }
+
+  /** load the k-th mixed event. Returns false if there is no such event or the block is corrupt. */
+  bool GetEntry(const uint64_t k);
+
+  TLorentzVector muPos() const { return m_muPos; }
+
+  TLorentzVector muNeg() const { return m_muNeg; }
+
+  TLorentzVector dimuon() const { return m_muPos + m_muNeg; }
+
+  unsigned posEvent() const { return m_pair.posEvent; }
+
+  unsigned negEvent() const { return m_pair.negEvent; }
+
+  unsigned flags() const { return m_pair.flags; }
+
+  double weight() const { return m_blockWeight; }
+
+private:
+  /** decode the block into m_pairs if it is not the current one. */
+  bool loadBlock(const Long64_t block);
+
+  /** get the cached chunk of input events containing entry (reading it if necessary). */
+  const MuonStore& chunk(const size_t entry);
+
+  TTree* m_indexTree;
+
+  TTree* m_inputTree;
+
+  EventT m_event;
+
+  size_t m_cacheEvents;
+
+  size_t m_cacheChunks;
+
+  std::vector<uint64_t> m_blockBegin; /**< index of the first pair of every block, and the total number at the end. */
+
+  Long64_t m_block{-1}; /**< currently decoded block. */
+
+  std::vector<PairIndex> m_pairs;
+
+  unsigned m_nPairs{};
+
+  unsigned m_nBytes{};
+
+  double m_blockWeight{1};
+
+  std::vector<unsigned char> m_bytes;
+
+  std::list<size_t> m_lru; /**< chunk numbers, most recently used first. */
+
+  std::unordered_map<size_t, MuonStore> m_chunks;
+
+  PairIndex m_pair{0, 0, 0};
+
+  TLorentzVector m_muPos;
+
+  TLorentzVector m_muNeg;
+};
+
+template<typename EventT>
+PairIndexReader<EventT>::PairIndexReader(TTree* indexTree, TTree* inputTree, const size_t cacheEvents,
+                                         const size_t cacheChunks)
+  : m_indexTree(indexTree), m_inputTree(inputTree), m_cacheEvents(std::max(size_t(1), cacheEvents)),
+    m_cacheChunks(std::max(size_t(1), cacheChunks))
+{
+  m_event.Init(m_inputTree);
+
+  // read only the sizes of all blocks first
+  m_indexTree->SetBranchStatus("*", false);
+  m_indexTree->SetBranchStatus("nPairs", true);
+  m_indexTree->SetBranchStatus("nBytes", true);
+  m_indexTree->SetBranchAddress("nPairs", &m_nPairs);
+  m_indexTree->SetBranchAddress("nBytes", &m_nBytes);
+
+  size_t maxBytes{};
+  const Long64_t nBlocks = m_indexTree->GetEntries();
+  m_blockBegin.reserve(nBlocks + 1);
+  m_blockBegin.push_back(0);
+  for (Long64_t b = 0; b < nBlocks; ++b) {
+    m_indexTree->GetEntry(b);
+    m_blockBegin.push_back(m_blockBegin.back() + m_nPairs);
+    maxBytes = std::max(maxBytes, size_t(m_nBytes));
+  }
+
+  m_indexTree->SetBranchStatus("*", true);
+  m_bytes.resize(std::max(size_t(1), maxBytes));
+  m_indexTree->SetBranchAddress("weight", &m_blockWeight);
+  m_indexTree->SetBranchAddress("pairs", m_bytes.data());
+}
+
+template<typename EventT>
+bool PairIndexReader<EventT>::GetEntry(const uint64_t k)
+{
+  if (k >= size()) return false;
+
+  const Long64_t block = std::upper_bound(m_blockBegin.begin(), m_blockBegin.end(), k) - m_blockBegin.begin() - 1;
+  if (!loadBlock(block)) return false;
+
+  m_pair = m_pairs[k - m_blockBegin[block]];
+  const MuonStore& posChunk = chunk(m_pair.posEvent);
+  m_muPos = posChunk.pos().get(m_pair.posEvent % m_cacheEvents);
+  const MuonStore& negChunk = chunk(m_pair.negEvent); // can invalidate posChunk
+  m_muNeg = negChunk.neg().get(m_pair.negEvent % m_cacheEvents);
+  return true;
+}
+
+template<typename EventT>
+bool PairIndexReader<EventT>::loadBlock(const Long64_t block)
+{
+  if (block == m_block) return true;
+
+  m_indexTree->GetEntry(block);
+  if (!decodePairBlock(m_bytes.data(), m_nBytes, m_nPairs, m_pairs)) {
+    std::cerr << "Could not decode block " << block << " of the pair indices" << std::endl;
+    m_block = -1;
+    return false;
+  }
+  m_block = block;
+  return true;
+}
+
+template<typename EventT>
+const MuonStore& PairIndexReader<EventT>::chunk(const size_t entry)
+{
+  const size_t number = entry / m_cacheEvents;
+  const auto it = m_chunks.find(number);
+  if (it != m_chunks.end()) {
+    if (m_lru.front() != number) {
+      m_lru.remove(number);
+      m_lru.push_front(number);
+    }
+    return it->second;
+  }
+
+  if (m_chunks.size() >= m_cacheChunks) {
+    m_chunks.erase(m_lru.back());
+    m_lru.pop_back();
+  }
+
+  MuonStore& store = m_chunks[number];
+  const size_t begin = number * m_cacheEvents;
+  const size_t end = std::min(begin + m_cacheEvents, size_t(m_inputTree->GetEntries()));
+  store.reserve(end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    m_inputTree->GetEntry(i);
+    store.add(m_event, i);
+  }
+  m_lru.push_front(number);
+  return store;
+}
+
+#endif
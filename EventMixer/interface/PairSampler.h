@@ -0,0 +1,128 @@
+#ifndef EVENTMIXER_PAIRSAMPLER_H__
+#define EVENTMIXER_PAIRSAMPLER_H__
+
+#include "TiledTriangle.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/** Settings for mixing only a random sample of all pairs. */
+struct PairSampling {
+  uint64_t nSamples{0}; /**< number of pairs to sample. If 0 the fraction is used. */
+  double fraction{1}; /**< fraction of all pairs to sample, if nSamples is 0. */
+  uint64_t seed{42}; /**< seed for the random permutation. Same seed and input give the same sample. */
+  size_t chunkSize{size_t(1) << 22}; /**< maximum number of sampled pairs that are held in memory at once. */
+};
+
+/**
+ * Counter-based random numbers: a fixed hash (the SplitMix64 finalizer) of key and counter. There is no state, so
+ * any value can be computed directly and independently of all others.
+ */
+inline uint64_t counterHash(const uint64_t key, const uint64_t counter)
+{
+  uint64_t z = key + 0x9e3779b97f4a7c15ULL * (counter + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Pseudo-random permutation of [0, n) defined by a seed.
+ * Uses a balanced Feistel network with counterHash as round function on the smallest even number of bits that
+ * covers n and 'cycle-walks' values that land outside of [0, n) until they are inside again. Taking the images of
+ * 0, 1, ..., m - 1 thus gives m distinct values, i.e. a uniform sample without replacement, without having to keep
+ * track of the values that have already been drawn.
+ */
+class RandomPermutation {
+public:
+  RandomPermutation(const uint64_t n, const uint64_t seed);
+
+  uint64_t operator()(uint64_t x) const;
+
+private:
+  uint64_t feistel(const uint64_t x) const;
+
+  uint64_t m_n;
+  uint64_t m_seed;
+  unsigned m_halfBits{1};
+  uint64_t m_halfMask;
+
+  static constexpr unsigned nRounds = 6;
+};
+
+RandomPermutation::RandomPermutation(const uint64_t n, const uint64_t seed) : m_n(n), m_seed(seed)
+{
+  while (m_halfBits < 32 && (uint64_t(1) << (2 * m_halfBits)) < n) ++m_halfBits;
+  m_halfMask = (uint64_t(1) << m_halfBits) - 1;
+}
+
+uint64_t RandomPermutation::feistel(const uint64_t x) const
+{
+  uint64_t left = x >> m_halfBits;
+  uint64_t right = x & m_halfMask;
+  for (unsigned r = 0; r < nRounds; ++r) {
+    const uint64_t newRight = left ^ (counterHash(m_seed + r, right) & m_halfMask);
+    left = right;
+    right = newRight;
+  }
+  return (left << m_halfBits) | right;
+}
+
+uint64_t RandomPermutation::operator()(uint64_t x) const
+{
+  do {
+    x = feistel(x);
+  } while (x >= m_n);
+  return x;
+}
+
+/**
+ * Uniform sample without replacement from all pairs i < j < nEvents, that is drawn in chunks of at most
+ * settings.chunkSize pairs, so that the memory does not grow with the size of the sample.
+ * Chunk c consists of the images of [c * chunkSize, (c + 1) * chunkSize) under a RandomPermutation of all pairs,
+ * i.e. the chunks are disjoint and together they form the same sample as drawing all pairs at once. Every chunk is
+ * returned as linear pair indices (see trianglePair) in ascending order, such that the pairs of a chunk can be
+ * processed in the same order as in the full loop.
+ */
+class PairSampleStream {
+public:
+  PairSampleStream(const uint64_t nEvents, const PairSampling& settings);
+
+  /** total number of sampled pairs (in all chunks). */
+  uint64_t size() const { return m_nSamples; }
+
+  /** number of pairs of the triangle the sample is drawn from. */
+  uint64_t nPairs() const { return m_nPairs; }
+
+  /** fill chunk with the next chunk of the sample. Returns false (and leaves chunk empty) if there is none. */
+  bool next(std::vector<uint64_t>& chunk);
+
+private:
+  uint64_t m_nPairs;
+  uint64_t m_nSamples;
+  size_t m_chunkSize;
+  RandomPermutation m_permutation;
+  uint64_t m_next{0}; /**< first permutation input of the next chunk. */
+};
+
+PairSampleStream::PairSampleStream(const uint64_t nEvents, const PairSampling& settings) :
+  m_nPairs(nTrianglePairs(nEvents)),
+  m_nSamples(std::min(settings.nSamples ? settings.nSamples :
+                      static_cast<uint64_t>(settings.fraction * m_nPairs + 0.5), m_nPairs)),
+  m_chunkSize(std::max(settings.chunkSize, size_t(1))),
+  m_permutation(m_nPairs, settings.seed)
+{
+}
+
+bool PairSampleStream::next(std::vector<uint64_t>& chunk)
+{
+  chunk.clear();
+  const uint64_t end = std::min(m_nSamples, m_next + m_chunkSize);
+  for (; m_next < end; ++m_next) chunk.push_back(m_permutation(m_next));
+  std::sort(chunk.begin(), chunk.end());
+  return !chunk.empty();
+}
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef EVENTMIXER_PRUNINGINDEX_H__
+#define EVENTMIXER_PRUNINGINDEX_H__
+
+#include "MuonStore.h"
+
+#include "TLorentzVector.h"
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <cmath>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Index to skip mixing candidates that provably can not end up in a mass window.
+ *
+ * For a fixed muon 1 and a muon 2 with energy E2 at an angle theta to muon 1 the pair mass is
+ *   M^2 = m1^2 + m2^2 + 2 (E1 E2 - |p1||p2| cos(theta)),  with  |p2| <= r E2,
+ * where r is the largest |p| / E (1 up to rounding). Bounding cos(theta) from above and below turns this into a
+ * lower and an upper bound on M^2 that are both linear (and rising) in E2.
+ *
+ * With only the energies, cos(theta) in [-1, 1] and the lower bound is useless for relativistic muons. Hence the
+ * muons of each charge are grouped into cones around a fixed set of directions and sorted by energy inside each
+ * cone. For each cone the angle to the fixed muon is bounded by the angle to the cone axis +- the cone opening,
+ * and the bounds on M^2 give one contiguous energy range that is found by binary search. All muons outside these
+ * ranges are skipped. The ranges are widened by a small margin, so that pairs at the window edges are never lost
+ * because of rounding and mixing only the candidates gives bit-identical output to the exhaustive loop.
+ *
+ * The same lookup works for any fixed four-momentum, e.g. for finding the third legs (photons) that can complete a
+ * dimuon to a triplet inside a mass window (see TripletMixer). For this the index is built over a single set of
+ * four-momenta (the legs) instead of the two charges of a MuonStore.
+ */
+class PruningIndex {
+public:
+  PruningIndex() = delete;
+
+  /**
+   * build the index for the passed store using nCones directions (0 chooses a number that grows with the size of
+   * the store). The store has to outlive the index and must not be changed.
+   */
+  PruningIndex(const MuonStore& store, const double massLow, const double massHigh, const size_t nCones = 0);
+
+  /** build the index for the passed legs only (see candidates(fixed, cands)). legs has to outlive the index. */
+  PruningIndex(const FourMomColumns& legs, const double massLow, const double massHigh, const size_t nCones = 0);
+
+  /**
+   * Fill cands with all j in [jBegin, jEnd) (in ascending order) for which at least one of the pairings
+   * pos(i) + neg(j) or neg(i) + pos(j) can have a mass inside the window.
+   * Returns false (and leaves cands empty) if the candidates are so dense, that mixing the whole range directly is
+   * cheaper than going through the list. Can be called concurrently.
+   */
+  bool candidates(const size_t i, const size_t jBegin, const size_t jEnd, std::vector<size_t>& cands) const;
+
+  /**
+   * Fill cands with the indices of all legs (in ascending order) for which fixed + leg can have a mass inside the
+   * window. Only for an index built over legs. Returns false (and leaves cands empty) if the candidates are so
+   * dense that going through all legs is cheaper. Can be called concurrently.
+   */
+  bool candidates(const TLorentzVector& fixed, std::vector<size_t>& cands) const;
+
+private:
+  /** unit vector. */
+  struct Direction {
+    double x;
+    double y;
+    double z;
+  };
+
+  /** all muons of one charge around one axis, sorted by energy. */
+  struct Cone {
+    std::vector<double> E; /**< sorted energies. */
+    std::vector<size_t> index; /**< index in the store for each energy. */
+    double cosOpening{1}; /**< cosine of the largest angle between a muon in the cone and the axis. */
+    double sinOpening{0}; /**< sine of the largest angle between a muon in the cone and the axis. */
+    double m2Min{std::numeric_limits<double>::infinity()}; /**< smallest squared mass. */
+    double m2Max{-std::numeric_limits<double>::infinity()}; /**< largest squared mass. */
+    double pOverEMax{1}; /**< largest |p| / E. */
+  };
+
+  using ConeRanges = std::vector<std::pair<size_t, size_t> >;
+
+  /** place nCones (or a number depending on nEvents if 0) axes on the unit sphere. */
+  void buildAxes(const size_t nCones, const size_t nEvents);
+
+  /** group the muons of one charge into cones around m_axes and sort them by energy. */
+  std::vector<Cone> buildCones(const FourMomColumns& cols) const;
+
+  /**
+   * ranges of sorted positions in each of the cones that can be in the window when paired with the fixed
+   * four-momentum (px, py, pz, E). Returns the total number of muons in the ranges.
+   */
+  size_t energyRanges(const double px, const double py, const double pz, const double E,
+                      const std::vector<Cone>& cones, ConeRanges& ranges) const;
+
+  const MuonStore* m_store{nullptr}; /**< nullptr for an index over legs only. */
+
+  size_t m_size; /**< number of events (or legs). */
+
+  std::vector<Direction> m_axes; /**< cone axes, spread evenly on the unit sphere. */
+
+  std::vector<Cone> m_posCones;
+
+  std::vector<Cone> m_negCones;
+
+  std::vector<Cone> m_legCones;
+
+  double m_massLow2; /**< squared lower bound, or -inf if there is none. */
+
+  double m_massHigh2; /**< squared upper bound. */
+
+  static constexpr double relMargin = 1e-6; /**< relative widening of the energy ranges. */
+
+  static constexpr double angleMargin = 1e-6; /**< widening of the angular ranges (in rad and in cos). */
+};
+
+PruningIndex::PruningIndex(const MuonStore& store, const double massLow, const double massHigh, const size_t nCones)
+  : m_store(&store), m_size(store.size()),
+    m_massLow2(massLow > 0 ? massLow * massLow : -std::numeric_limits<double>::infinity()),
+    m_massHigh2(massHigh * massHigh)
+{
+  buildAxes(nCones, store.size());
+  m_posCones = buildCones(store.pos());
+  m_negCones = buildCones(store.neg());
+}
+
+PruningIndex::PruningIndex(const FourMomColumns& legs, const double massLow, const double massHigh,
+                           const size_t nCones)
+  : m_size(legs.size()), m_massLow2(massLow > 0 ? massLow * massLow : -std::numeric_limits<double>::infinity()),
+    m_massHigh2(massHigh * massHigh)
+{
+  buildAxes(nCones, legs.size());
+  m_legCones = buildCones(legs);
+}
+
+void PruningIndex::buildAxes(const size_t nCones, const size_t nEvents)
+{
+  // the lookup costs O(nCones) per event, so it has to stay well below the size of the store
+  const size_t n = nCones ? nCones : std::max(size_t(16), std::min(size_t(1024), nEvents / 100));
+
+  // Fibonacci lattice on the unit sphere for (almost) evenly spread axes
+  const double goldenAngle = M_PI * (3 - std::sqrt(5.0));
+  for (size_t k = 0; k < n; ++k) {
+    const double z = 1 - (2 * k + 1) / static_cast<double>(n);
+    const double rho = std::sqrt(1 - z * z);
+    m_axes.push_back(Direction{rho * std::cos(goldenAngle * k), rho * std::sin(goldenAngle * k), z});
+  }
+}
+
+std::vector<PruningIndex::Cone> PruningIndex::buildCones(const FourMomColumns& cols) const
+{
+  std::vector<Cone> cones(m_axes.size());
+  std::vector<std::vector<std::pair<double, size_t> > > members(m_axes.size());
+
+  for (size_t k = 0; k < cols.size(); ++k) {
+    const double p = std::sqrt(cols.px[k] * cols.px[k] + cols.py[k] * cols.py[k] + cols.pz[k] * cols.pz[k]);
+    size_t best{};
+    double bestDot = -1; // muons without a direction can be at any angle to the axis
+    if (p > 0) {
+      bestDot = -2;
+      for (size_t a = 0; a < m_axes.size(); ++a) {
+        const double dot = (cols.px[k] * m_axes[a].x + cols.py[k] * m_axes[a].y + cols.pz[k] * m_axes[a].z) / p;
+        if (dot > bestDot) {
+          bestDot = dot;
+          best = a;
+        }
+      }
+    }
+
+    Cone& cone = cones[best];
+    const double E = cols.E[k];
+    cone.cosOpening = std::min(cone.cosOpening, std::max(-1.0, bestDot));
+    cone.m2Min = std::min(cone.m2Min, E * E - p * p);
+    cone.m2Max = std::max(cone.m2Max, E * E - p * p);
+    if (E > 0) cone.pOverEMax = std::max(cone.pOverEMax, p / E);
+    members[best].push_back(std::make_pair(E, k));
+  }
+
+  for (size_t a = 0; a < m_axes.size(); ++a) {
+    // widen the opening a bit to cover rounding in the angles
+    const double opening = std::min(M_PI, std::acos(cones[a].cosOpening) + angleMargin);
+    cones[a].cosOpening = std::cos(opening);
+    cones[a].sinOpening = std::sin(opening);
+
+    std::sort(members[a].begin(), members[a].end());
+    for (const auto& m : members[a]) {
+      cones[a].E.push_back(m.first);
+      cones[a].index.push_back(m.second);
+    }
+  }
+
+  return cones;
+}
+
+size_t PruningIndex::energyRanges(const double px, const double py, const double pz, const double E,
+                                  const std::vector<Cone>& cones, ConeRanges& ranges) const
+{
+  const double E1 = E;
+  const double p1 = std::sqrt(px * px + py * py + pz * pz);
+  const double m1sq = E1 * E1 - p1 * p1;
+
+  ranges.clear();
+  size_t nInRanges{};
+  for (size_t a = 0; a < cones.size(); ++a) {
+    const Cone& cone = cones[a];
+    if (cone.E.empty()) {
+      ranges.push_back(std::make_pair(size_t(0), size_t(0)));
+      continue;
+    }
+
+    // range of possible cos(theta) between muon 1 and any muon in the cone, from the angle between muon 1 and the
+    // axis +- the opening of the cone (cos(a -+ b) = cos(a) cos(b) +- sin(a) sin(b))
+    double cosMax = 1;
+    double cosMin = -1;
+    if (p1 > 0) {
+      const double c = (px * m_axes[a].x + py * m_axes[a].y + pz * m_axes[a].z) / p1;
+      const double s = std::sqrt(std::max(0.0, 1 - c * c));
+      if (c < cone.cosOpening) cosMax = std::min(1.0, c * cone.cosOpening + s * cone.sinOpening + angleMargin);
+      if (c > -cone.cosOpening) cosMin = std::max(-1.0, c * cone.cosOpening - s * cone.sinOpening - angleMargin);
+    }
+
+    // upper mass bound has to reach the lower window edge -> minimal E2
+    double eMin = -std::numeric_limits<double>::infinity();
+    const double slopeUp = 2 * (E1 + cone.pOverEMax * p1 * std::max(-cosMin, 0.0));
+    if (std::isfinite(m_massLow2) && slopeUp > 0) {
+      eMin = (m_massLow2 - m1sq - cone.m2Max) / slopeUp;
+      eMin -= relMargin * (std::abs(eMin) + m_massLow2 / slopeUp);
+    }
+
+    // lower mass bound has to stay below the upper window edge -> maximal E2 (only if the bound rises with E2)
+    double eMax = std::numeric_limits<double>::infinity();
+    const double slopeLow = 2 * (E1 - cone.pOverEMax * p1 * std::max(cosMax, 0.0));
+    if (slopeLow > 0) {
+      eMax = (m_massHigh2 - m1sq - cone.m2Min) / slopeLow;
+      eMax += relMargin * (std::abs(eMax) + m_massHigh2 / slopeLow);
+    }
+
+    if (eMin > cone.E.back() || eMax < cone.E.front()) { // nothing in this cone
+      ranges.push_back(std::make_pair(size_t(0), size_t(0)));
+      continue;
+    }
+
+    const size_t first = std::lower_bound(cone.E.begin(), cone.E.end(), eMin) - cone.E.begin();
+    const size_t last = std::max(first, size_t(std::upper_bound(cone.E.begin(), cone.E.end(), eMax) - cone.E.begin()));
+    ranges.push_back(std::make_pair(first, last));
+    nInRanges += last - first;
+  }
+
+  return nInRanges;
+}
+
+bool PruningIndex::candidates(const size_t i, const size_t jBegin, const size_t jEnd,
+                              std::vector<size_t>& cands) const
+{
+  cands.clear();
+  if (jBegin >= jEnd) return true;
+
+  const FourMomColumns& pos = m_store->pos();
+  const FourMomColumns& neg = m_store->neg();
+  ConeRanges rangesA; // pos(i) + neg(j)
+  ConeRanges rangesB; // neg(i) + pos(j)
+  const size_t nRange = energyRanges(pos.px[i], pos.py[i], pos.pz[i], pos.E[i], m_negCones, rangesA) +
+    energyRanges(neg.px[i], neg.py[i], neg.pz[i], neg.E[i], m_posCones, rangesB);
+
+  // if the ranges cover a large part of the store, sorting the candidates costs more than it saves
+  if (4 * nRange > m_size) return false;
+
+  // mark the candidates in a bitmap over [jBegin, jEnd) to get them in ascending order without sorting
+  std::vector<uint64_t> marked((jEnd - jBegin + 63) / 64, 0);
+  const auto mark = [&marked, jBegin, jEnd](const ConeRanges& ranges, const std::vector<Cone>& cones) {
+    for (size_t a = 0; a < cones.size(); ++a) {
+      for (size_t s = ranges[a].first; s < ranges[a].second; ++s) {
+        const size_t j = cones[a].index[s];
+        if (j >= jBegin && j < jEnd) marked[(j - jBegin) / 64] |= uint64_t(1) << ((j - jBegin) % 64);
+      }
+    }
+  };
+  mark(rangesA, m_negCones);
+  mark(rangesB, m_posCones);
+
+  for (size_t w = 0; w < marked.size(); ++w) {
+    uint64_t bits = marked[w];
+    while (bits) {
+      cands.push_back(jBegin + 64 * w + __builtin_ctzll(bits));
+      bits &= bits - 1;
+    }
+  }
+  return true;
+}
+
+bool PruningIndex::candidates(const TLorentzVector& fixed, std::vector<size_t>& cands) const
+{
+  cands.clear();
+  ConeRanges ranges;
+  const size_t nRange = energyRanges(fixed.Px(), fixed.Py(), fixed.Pz(), fixed.E(), m_legCones, ranges);
+  if (4 * nRange > m_size) return false;
+
+  // called once per pair, so sort the (few) candidates instead of marking them in a bitmap over all legs
+  cands.reserve(nRange);
+  for (size_t a = 0; a < m_legCones.size(); ++a) {
+    for (size_t s = ranges[a].first; s < ranges[a].second; ++s) cands.push_back(m_legCones[a].index[s]);
+  }
+  std::sort(cands.begin(), cands.end());
+  return true;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef EVENTMIXER_SHARDING_H__
+#define EVENTMIXER_SHARDING_H__
+
+#include "TiledTriangle.h"
+#include "TreeUserInfo.h"
+
+#include "TTree.h"
+
+#include <string>
+#include <utility>
+#include <cstdint>
+
+/**
+ * range [first, second) of pairs (counted row by row as in trianglePair) that belongs to shard of nShards, when the
+ * triangle of all pairs i < j < nEvents is split into nShards consecutive parts with equal numbers of pairs (up to
+ * one). Concatenating the shards in ascending order gives the order of the serial loop.
+ */
+std::pair<uint64_t, uint64_t> shardPairRange(const uint64_t nEvents, const unsigned shard, const unsigned nShards)
+{
+  const uint64_t nPairs = nTrianglePairs(nEvents);
+  // k * nPairs / nShards without overflow of the product
+  const auto boundary = [nPairs, nShards](const uint64_t k) {
+    return nPairs / nShards * k + nPairs % nShards * k / nShards;
+  };
+  return std::make_pair(boundary(shard), boundary(shard + 1));
+}
+
+/**
+ * Which part of the triangle is in an output file, stored in the UserInfo of the output TTree.
+ * An unsharded run is shard 0 of 1 covering all pairs.
+ */
+struct ShardInfo {
+  uint64_t nEvents{}; /**< number of input events of the full triangle. */
+  unsigned shard{}; /**< index of this shard. */
+  unsigned nShards{1}; /**< total number of shards. */
+  uint64_t pairBegin{}; /**< first pair of this shard. */
+  uint64_t pairEnd{}; /**< one past the last pair of this shard. */
+
+  /** put the information into the UserInfo of the tree (overwriting previous information). */
+  void store(TTree* tree) const;
+
+  /** read the information from the UserInfo of the tree. Returns false if it is not (completely) there. */
+  bool load(TTree* tree);
+};
+
+namespace shard_detail {
+  /** name prefix of the values in the UserInfo. */
+  const std::string prefix = "mixShard_";
+}
+
+void ShardInfo::store(TTree* tree) const
+{
+  using shard_detail::prefix;
+  setUserInfoValue(tree, prefix + "nEvents", nEvents);
+  setUserInfoValue(tree, prefix + "shard", shard);
+  setUserInfoValue(tree, prefix + "nShards", nShards);
+  setUserInfoValue(tree, prefix + "pairBegin", pairBegin);
+  setUserInfoValue(tree, prefix + "pairEnd", pairEnd);
+}
+
+bool ShardInfo::load(TTree* tree)
+{
+  using shard_detail::prefix;
+  Long64_t events, index, n, begin, end;
+  if (!getUserInfoValue(tree, prefix + "nEvents", events) || !getUserInfoValue(tree, prefix + "shard", index) ||
+      !getUserInfoValue(tree, prefix + "nShards", n) || !getUserInfoValue(tree, prefix + "pairBegin", begin) ||
+      !getUserInfoValue(tree, prefix + "pairEnd", end)) {
+    return false;
+  }
+
+  nEvents = events;
+  shard = index;
+  nShards = n;
+  pairBegin = begin;
+  pairEnd = end;
+  return true;
+}
+
+#endif
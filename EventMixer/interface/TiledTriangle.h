@@ -0,0 +1,258 @@
+#ifndef EVENTMIXER_TILEDTRIANGLE_H__
+#define EVENTMIXER_TILEDTRIANGLE_H__
+
+#include "general/work_stealing_pool.h"
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <utility>
+
+/** number of pairs i < j < n. */
+inline uint64_t nTrianglePairs(const uint64_t n)
+{
+  return n < 2 ? 0 : n * (n - 1) / 2;
+}
+
+/** index of the first pair (i, i + 1) of row i, when all pairs i < j < n are counted row by row. */
+inline uint64_t triangleRowOffset(const uint64_t n, const uint64_t i)
+{
+  return i * (2 * n - i - 1) / 2;
+}
+
+/** get the pair (i, j) with i < j < n that is the k-th pair when counting row by row (inverse of the above). */
+std::pair<size_t, size_t> trianglePair(const uint64_t n, const uint64_t k)
+{
+  // solve triangleRowOffset(n, i) = k for i and correct for rounding
+  const double b = 2.0 * n - 1;
+  uint64_t i = static_cast<uint64_t>(std::max(0.0, std::floor((b - std::sqrt(std::max(0.0, b * b - 8.0 * k))) / 2)));
+  if (i > n - 2) i = n - 2;
+  while (i > 0 && triangleRowOffset(n, i) > k) --i;
+  while (i + 1 < n - 1 && triangleRowOffset(n, i + 1) <= k) ++i;
+
+  return std::make_pair(size_t(i), size_t(i + 1 + (k - triangleRowOffset(n, i))));
+}
+
+/** Settings for the parallel processing of the triangle of all pairs i < j. */
+struct TileSettings {
+  unsigned nThreads{1}; /**< number of worker threads. */
+  size_t tileSize{512}; /**< number of events per block. A tile touches 2 * tileSize events. */
+  bool deterministic{true}; /**< write the output in the same order as the serial loop. */
+  bool fullRows{false}; /**< make every stripe one tile over all j (for row-wise lookups, e.g. a PruningIndex). */
+};
+
+/**
+ * One (i-block, j-block) tile of the triangle i < j. All tiles with the same i-block form a stripe.
+ * The pairs in the tile are all i in [iBegin, iEnd) combined with j in [max(i + 1, jBegin), jEnd).
+ */
+struct Tile {
+  size_t stripe;
+  size_t iBegin;
+  size_t iEnd;
+  size_t jBegin;
+  size_t jEnd;
+
+  /** number of pairs i < j in this tile. */
+  size_t nPairs() const;
+};
+
+size_t Tile::nPairs() const
+{
+  size_t n{};
+  for (size_t i = iBegin; i < iEnd; ++i) {
+    const size_t first = std::max(i + 1, jBegin);
+    if (first < jEnd) n += jEnd - first;
+  }
+  return n;
+}
+
+/**
+ * split the triangle i < j < nEvents into tiles of tileSize x tileSize, ordered by stripe and j-block.
+ * If fullRows is set every stripe consists of only one tile spanning all j.
+ */
+std::vector<Tile> triangleTiles(const size_t nEvents, size_t tileSize, const bool fullRows = false)
+{
+  if (!tileSize) tileSize = 1;
+  const size_t nBlocks = (nEvents + tileSize - 1) / tileSize;
+
+  std::vector<Tile> tiles;
+  tiles.reserve(fullRows ? nBlocks : nBlocks * (nBlocks + 1) / 2);
+  for (size_t iB = 0; iB < nBlocks; ++iB) {
+    if (fullRows) {
+      tiles.push_back(Tile{iB, iB * tileSize, std::min(nEvents, (iB + 1) * tileSize), iB * tileSize, nEvents});
+      continue;
+    }
+    for (size_t jB = iB; jB < nBlocks; ++jB) {
+      tiles.push_back(Tile{iB, iB * tileSize, std::min(nEvents, (iB + 1) * tileSize),
+                           jB * tileSize, std::min(nEvents, (jB + 1) * tileSize)});
+    }
+  }
+  return tiles;
+}
+
+/** output buffer of one tile, that keeps track of where the output of each row starts. */
+template<typename T>
+struct RowBuffer {
+  std::vector<T> items;
+  std::vector<size_t> rowBegins;
+
+  void startRow() { rowBegins.push_back(items.size()); }
+
+  size_t rowEnd(const size_t row) const { return row + 1 < rowBegins.size() ? rowBegins[row + 1] : items.size(); }
+};
+
+/**
+ * Process all pairs i < j < nEvents in tiles on settings.nThreads worker threads.
+ *
+ * rowFunc(size_t i, size_t jBegin, size_t jEnd, std::vector<T>& out) is called on the worker threads for every
+ * row segment of a tile and has to append its output to out, which is the buffer owned by the worker for that
+ * tile. It is called concurrently and has to be thread-safe.
+ * flush(const T&) is called for every output item and progress(size_t pairsDone) after every merge, both on the
+ * calling thread only, so that they can write to a shared output without locking.
+ *
+ * If settings.deterministic is set, the output of a stripe is only flushed once all of its tiles are done and
+ * it is then flushed row by row, such that the order is the same as in a serial loop over i and j. Otherwise the
+ * output of every tile is flushed as soon as it is available.
+ */
+template<typename T, typename RowF, typename FlushF, typename ProgressF>
+void processTiledTriangle(const size_t nEvents, const TileSettings& settings, RowF rowFunc, FlushF flush,
+                          ProgressF progress)
+{
+  const std::vector<Tile> tiles = triangleTiles(nEvents, settings.tileSize, settings.fullRows);
+  if (tiles.empty()) return;
+
+  // tiles are ordered by stripe, so every stripe is a contiguous range of tiles
+  const size_t nStripes = tiles.back().stripe + 1;
+  std::vector<size_t> stripeBegin(nStripes + 1, tiles.size());
+  for (size_t t = tiles.size(); t-- > 0;) stripeBegin[tiles[t].stripe] = t;
+
+  std::vector<RowBuffer<T> > buffers(tiles.size());
+  std::deque<size_t> finished; // tiles done by the workers, but not yet seen by the merging thread
+  std::mutex mutex;
+  std::condition_variable doneCondition;
+
+  WorkStealingPool pool(settings.nThreads);
+  pool.start(tiles.size(), [&](const size_t t, const unsigned) {
+      const Tile& tile = tiles[t];
+      RowBuffer<T> buffer;
+      for (size_t i = tile.iBegin; i < tile.iEnd; ++i) {
+        buffer.startRow();
+        const size_t jBegin = std::max(i + 1, tile.jBegin);
+        if (jBegin < tile.jEnd) rowFunc(i, jBegin, tile.jEnd, buffer.items);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers[t] = std::move(buffer);
+        finished.push_back(t);
+      }
+      doneCondition.notify_one();
+    });
+
+  std::vector<char> done(tiles.size(), 0);
+  size_t nextStripe{};
+  size_t nMerged{};
+  size_t pairsDone{};
+
+  while (nMerged < tiles.size()) {
+    std::vector<size_t> ready;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      doneCondition.wait(lock, [&finished]() { return !finished.empty(); });
+      ready.assign(finished.begin(), finished.end());
+      finished.clear();
+    }
+
+    if (!settings.deterministic) {
+      for (const size_t t : ready) {
+        for (const auto& item : buffers[t].items) flush(item);
+        buffers[t] = RowBuffer<T>(); // release the memory
+        pairsDone += tiles[t].nPairs();
+        nMerged++;
+      }
+    } else {
+      for (const size_t t : ready) done[t] = 1;
+
+      while (nextStripe < nStripes &&
+             std::all_of(done.begin() + stripeBegin[nextStripe], done.begin() + stripeBegin[nextStripe + 1],
+                         [](const char d) { return d; })) {
+        const size_t first = stripeBegin[nextStripe];
+        const size_t last = stripeBegin[nextStripe + 1];
+        const size_t nRows = tiles[first].iEnd - tiles[first].iBegin;
+        for (size_t row = 0; row < nRows; ++row) {
+          for (size_t t = first; t < last; ++t) {
+            const auto& buffer = buffers[t];
+            for (size_t k = buffer.rowBegins[row]; k < buffer.rowEnd(row); ++k) flush(buffer.items[k]);
+          }
+        }
+        for (size_t t = first; t < last; ++t) {
+          pairsDone += tiles[t].nPairs();
+          buffers[t] = RowBuffer<T>();
+          nMerged++;
+        }
+        nextStripe++;
+      }
+    }
+
+    progress(pairsDone);
+  }
+
+  pool.wait();
+}
+
+/**
+ * Process all pairs i < j < nEvents in tiles on settings.nThreads worker threads, without collecting any output
+ * (e.g. for filling thread-local sinks).
+ *
+ * rowFunc(size_t i, size_t jBegin, size_t jEnd, unsigned worker) is called on the worker threads for every row
+ * segment of a tile, where worker is in [0, settings.nThreads) (or 0 if settings.nThreads is 0), and no two calls
+ * with the same worker happen concurrently. progress(size_t pairsDone) is called on the calling thread.
+ * The order of the rows is not defined (settings.deterministic has no effect).
+ */
+template<typename RowF, typename ProgressF>
+void processTiles(const size_t nEvents, const TileSettings& settings, RowF rowFunc, ProgressF progress)
+{
+  const std::vector<Tile> tiles = triangleTiles(nEvents, settings.tileSize, settings.fullRows);
+  if (tiles.empty()) return;
+
+  std::mutex mutex;
+  std::condition_variable doneCondition;
+  size_t nDone{};
+  size_t pairsDone{};
+
+  WorkStealingPool pool(settings.nThreads);
+  pool.start(tiles.size(), [&](const size_t t, const unsigned worker) {
+      const Tile& tile = tiles[t];
+      for (size_t i = tile.iBegin; i < tile.iEnd; ++i) {
+        const size_t jBegin = std::max(i + 1, tile.jBegin);
+        if (jBegin < tile.jEnd) rowFunc(i, jBegin, tile.jEnd, worker);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        nDone++;
+        pairsDone += tile.nPairs();
+      }
+      doneCondition.notify_one();
+    });
+
+  size_t nSeen{};
+  while (nSeen < tiles.size()) {
+    size_t pairs;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      doneCondition.wait(lock, [&nDone, nSeen]() { return nDone > nSeen; });
+      nSeen = nDone;
+      pairs = pairsDone;
+    }
+    progress(pairs);
+  }
+
+  pool.wait();
+}
+
+#endif
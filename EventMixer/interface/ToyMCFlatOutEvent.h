@@ -0,0 +1,187 @@
+#ifndef EVENTMIXER_TOYMCFLATOUTEVENT_H__
+#define EVENTMIXER_TOYMCFLATOUTEVENT_H__
+
+#include "ToyMCOutEvent.h"
+#include "../config/MixerSettings.h"
+
+#include "TLorentzVector.h"
+#include "TTree.h"
+
+#include <string>
+#include <array>
+
+/** names of the four flat columns of the four-momentum name in the passed (flat) layout. */
+std::array<std::string, 4> flatColumnNames(const std::string& name, const config::OutputLayout layout)
+{
+  if (layout == config::OutputLayout::PtEtaPhiM) {
+    return {{name + "_pt", name + "_eta", name + "_phi", name + "_mass"}};
+  }
+  return {{name + "_px", name + "_py", name + "_pz", name + "_E"}};
+}
+
+/** One four-momentum stored in four flat columns of type FloatT in one of the flat layouts. */
+template<typename FloatT>
+struct FlatFourMom {
+  std::array<FloatT, 4> values{}; /**< (px, py, pz, E) or (pt, eta, phi, mass). */
+
+  void set(const TLorentzVector& p, const config::OutputLayout layout);
+
+  TLorentzVector get(const config::OutputLayout layout) const;
+
+  /** create the four branches in the tree. */
+  void branch(TTree* tree, const std::string& name, const config::OutputLayout layout);
+
+  /** set the addresses of the four (existing) branches in the tree. */
+  void setAddress(TTree* tree, const std::string& name, const config::OutputLayout layout);
+};
+
+template<typename FloatT>
+void FlatFourMom<FloatT>::set(const TLorentzVector& p, const config::OutputLayout layout)
+{
+  if (layout == config::OutputLayout::PtEtaPhiM) {
+    values = {{FloatT(p.Pt()), FloatT(p.Eta()), FloatT(p.Phi()), FloatT(p.M())}};
+  } else {
+    values = {{FloatT(p.Px()), FloatT(p.Py()), FloatT(p.Pz()), FloatT(p.E())}};
+  }
+}
+
+template<typename FloatT>
+TLorentzVector FlatFourMom<FloatT>::get(const config::OutputLayout layout) const
+{
+  TLorentzVector p;
+  if (layout == config::OutputLayout::PtEtaPhiM) {
+    p.SetPtEtaPhiM(values[0], values[1], values[2], values[3]);
+  } else {
+    p.SetPxPyPzE(values[0], values[1], values[2], values[3]);
+  }
+  return p;
+}
+
+template<typename FloatT>
+void FlatFourMom<FloatT>::branch(TTree* tree, const std::string& name, const config::OutputLayout layout)
+{
+  const auto names = flatColumnNames(name, layout);
+  for (size_t k = 0; k < 4; ++k) tree->Branch(names[k].c_str(), &values[k]);
+}
+
+template<typename FloatT>
+void FlatFourMom<FloatT>::setAddress(TTree* tree, const std::string& name, const config::OutputLayout layout)
+{
+  const auto names = flatColumnNames(name, layout);
+  for (size_t k = 0; k < 4; ++k) tree->SetBranchAddress(names[k].c_str(), &values[k]);
+}
+
+/**
+ * Output Event for ToyMC samples with the same content (and interface) as ToyMCOutEvent, but storing the
+ * four-momenta in flat float or double columns instead of TLorentzVector object branches. Which columns are used
+ * is set by config::OutputFormat.layout (PxPyPzE or PtEtaPhiM). Files in all layouts can be read with
+ * ToyMCMixedEvent.
+ */
+template<typename FloatT = double>
+class ToyMCFlatOutEvent {
+public:
+  using Record = ToyMCOutEvent::Record;
+
+  ToyMCFlatOutEvent() = default;
+
+  /** constructor from all the necessary information. */
+  ToyMCFlatOutEvent(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+                    unsigned i, unsigned j, unsigned flags = 0);
+
+  void Init(TTree* tree);
+
+  /** set the branch addresses of a TTree that has been created by Init() before (e.g. to append to it). */
+  void Attach(TTree* tree);
+
+  /** set all information as in the constructor. Resets the weight to 1. */
+  void set(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+           unsigned i, unsigned j, unsigned flags = 0);
+
+  /** set all information from a Record. */
+  void set(const Record& record);
+
+  TLorentzVector muPos() const { return m_muPos.get(m_layout); }
+
+  TLorentzVector muNeg() const { return m_muNeg.get(m_layout); }
+
+  TLorentzVector dimuon() const { return m_dimuon.get(m_layout); }
+
+  void setPosEv(const size_t i) { m_posEvent = i; }
+
+  void setNegEv(const size_t i) { m_negEvent = i; }
+
+  /** set the weight of the event (e.g. when only a sample of all pairs is mixed). */
+  void setWeight(const double w) { m_weight = w; }
+
+private:
+
+  /** layout of the columns. LorentzVectors and PairIndices are not possible here and fall back to PxPyPzE. */
+  config::OutputLayout m_layout{config::OutputFormat.layout == config::OutputLayout::PtEtaPhiM ?
+      config::OutputLayout::PtEtaPhiM : config::OutputLayout::PxPyPzE};
+
+  FlatFourMom<FloatT> m_muPos;
+
+  FlatFourMom<FloatT> m_muNeg;
+
+  FlatFourMom<FloatT> m_dimuon;
+
+  unsigned m_posEvent{};
+
+  unsigned m_negEvent{};
+
+  unsigned m_flags{}; /**< storing additional information. */
+
+  double m_weight{1}; /**< event weight. */
+};
+
+template<typename FloatT>
+ToyMCFlatOutEvent<FloatT>::ToyMCFlatOutEvent(const TLorentzVector& muPos, const TLorentzVector& muNeg,
+                                             const TLorentzVector& dimuon, unsigned i, unsigned j, unsigned flags)
+{
+  set(muPos, muNeg, dimuon, i, j, flags);
+}
+
+template<typename FloatT>
+void ToyMCFlatOutEvent<FloatT>::set(const TLorentzVector& muPos, const TLorentzVector& muNeg,
+                                    const TLorentzVector& dimuon, unsigned i, unsigned j, unsigned flags)
+{
+  m_muPos.set(muPos, m_layout);
+  m_muNeg.set(muNeg, m_layout);
+  m_dimuon.set(dimuon, m_layout);
+  m_posEvent = i;
+  m_negEvent = j;
+  m_flags = flags;
+  m_weight = 1;
+}
+
+template<typename FloatT>
+void ToyMCFlatOutEvent<FloatT>::set(const Record& record)
+{
+  set(record.muPos, record.muNeg, record.dimuon, record.posEvent, record.negEvent, record.flags);
+}
+
+template<typename FloatT>
+void ToyMCFlatOutEvent<FloatT>::Init(TTree* tree)
+{
+  m_muPos.branch(tree, config::OutputTree.muPosName, m_layout);
+  m_muNeg.branch(tree, config::OutputTree.muNegName, m_layout);
+  m_dimuon.branch(tree, config::OutputTree.diMuName, m_layout);
+  tree->Branch("posEventNo", &m_posEvent);
+  tree->Branch("negEventNo", &m_negEvent);
+  tree->Branch("weight", &m_weight);
+  tree->Branch("flags", &m_flags);
+}
+
+template<typename FloatT>
+void ToyMCFlatOutEvent<FloatT>::Attach(TTree* tree)
+{
+  m_muPos.setAddress(tree, config::OutputTree.muPosName, m_layout);
+  m_muNeg.setAddress(tree, config::OutputTree.muNegName, m_layout);
+  m_dimuon.setAddress(tree, config::OutputTree.diMuName, m_layout);
+  tree->SetBranchAddress("posEventNo", &m_posEvent);
+  tree->SetBranchAddress("negEventNo", &m_negEvent);
+  tree->SetBranchAddress("weight", &m_weight);
+  tree->SetBranchAddress("flags", &m_flags);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef EVENTMIXER_TOYMCINDEXOUTEVENT_H__
+#define EVENTMIXER_TOYMCINDEXOUTEVENT_H__
+
+#include "ToyMCOutEvent.h"
+#include "PairIndexCodec.h"
+#include "../config/MixerSettings.h"
+
+#include "TLorentzVector.h"
+#include "TTree.h"
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Output Event for ToyMC samples that stores only the indices of the two input events (and the flags) of every
+ * mixed event, since the four-momenta can be rebuilt from the input TTree (see PairIndexReader).
+ *
+ * Has the same interface as ToyMCOutEvent, but collects the pairs in blocks of blockSize pairs that are written as
+ * one entry of the output TTree, with the branches
+ * - nPairs: number of pairs in the block
+ * - nBytes: number of bytes of the encoded pairs
+ * - weight: the weight of all pairs in the block (a block is written early if the weight changes)
+ * - pairs[nBytes]: the pairs sorted by (posEventNo, negEventNo) and encoded with encodePairBlock
+ *
+ * The EventMixer and the sinks call Fill(tree) instead of tree->Fill() for this event (see fillOutput), and Flush
+ * before the output is saved (see flushOutput). The order of the pairs is hence only kept between the blocks.
+ */
+class ToyMCIndexOutEvent {
+public:
+  using Record = ToyMCOutEvent::Record;
+
+  ToyMCIndexOutEvent(const size_t blockSize = config::OutputFormat.indexBlockSize);
+
+  /** not copyable, since the address of the byte buffer is set for the TTree. */
+  ToyMCIndexOutEvent(const ToyMCIndexOutEvent&) = delete;
+
+  ToyMCIndexOutEvent& operator=(const ToyMCIndexOutEvent&) = delete;
+
+  void Init(TTree* tree);
+
+  /** set the branch addresses of a TTree that has been created by Init() before (e.g. to append to it). */
+  void Attach(TTree* tree);
+
+  /** set all information as for a ToyMCOutEvent. Only i, j and flags are stored. Resets the weight to 1. */
+  void set(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+           unsigned i, unsigned j, unsigned flags = 0);
+
+  /** set all information from a Record. */
+  void set(const Record& record);
+
+  void setPosEv(const size_t i) { m_current.posEvent = i; }
+
+  void setNegEv(const size_t i) { m_current.negEvent = i; }
+
+  /** set the weight of the event (e.g. when only a sample of all pairs is mixed). */
+  void setWeight(const double w) { m_weight = w; }
+
+  /** add the current pair to the block and write the block to the tree if it is full. */
+  void Fill(TTree* tree);
+
+  /** write the (partial) block to the tree. */
+  void Flush(TTree* tree);
+
+private:
+  size_t m_blockSize;
+
+  PairIndex m_current{0, 0, 0};
+
+  double m_weight{1}; /**< weight of the current pair. */
+
+  std::vector<PairIndex> m_pairs; /**< the pairs of the current block. */
+
+  std::vector<unsigned char> m_bytes; /**< encoded pairs. Never reallocated after construction. */
+
+  unsigned m_nPairs{};
+
+  unsigned m_nBytes{};
+
+  double m_blockWeight{1};
+};
+
+ToyMCIndexOutEvent::ToyMCIndexOutEvent(const size_t blockSize)
+  : m_blockSize(blockSize ? blockSize : 1), m_bytes(m_blockSize * maxPairIndexBytes)
+{
+  m_pairs.reserve(m_blockSize);
+}
+
+void ToyMCIndexOutEvent::set(const TLorentzVector&, const TLorentzVector&, const TLorentzVector&,
+                             unsigned i, unsigned j, unsigned flags)
+{
+  m_current = PairIndex{i, j, flags};
+  m_weight = 1;
+}
+
+void ToyMCIndexOutEvent::set(const Record& record)
+{
+  m_current = PairIndex{record.posEvent, record.negEvent, record.flags};
+  m_weight = 1;
+}
+
+void ToyMCIndexOutEvent::Fill(TTree* tree)
+{
+  if (!m_pairs.empty() && m_weight != m_blockWeight) Flush(tree);
+  m_blockWeight = m_weight;
+  m_pairs.push_back(m_current);
+  if (m_pairs.size() >= m_blockSize) Flush(tree);
+}
+
+void ToyMCIndexOutEvent::Flush(TTree* tree)
+{
+  if (m_pairs.empty()) return;
+  m_nPairs = m_pairs.size();
+  m_nBytes = encodePairBlock(m_pairs, m_bytes.data());
+  tree->Fill();
+  m_pairs.clear();
+}
+
+void ToyMCIndexOutEvent::Init(TTree* tree)
+{
+  tree->Branch("nPairs", &m_nPairs);
+  tree->Branch("nBytes", &m_nBytes);
+  tree->Branch("weight", &m_blockWeight);
+  tree->Branch("pairs", m_bytes.data(), "pairs[nBytes]/b");
+}
+
+void ToyMCIndexOutEvent::Attach(TTree* tree)
+{
+  tree->SetBranchAddress("nPairs", &m_nPairs);
+  tree->SetBranchAddress("nBytes", &m_nBytes);
+  tree->SetBranchAddress("weight", &m_blockWeight);
+  tree->SetBranchAddress("pairs", m_bytes.data());
+}
+
+#endif
@@ -3,11 +3,17 @@
 
 #include "ToyMCEvent.h"
 #include "ToyMCOutEvent.h"
+#include "MuonStore.h"
+#include "MassWindowKernel.h"
 
 #include "../config/MixerSettings.h"
 
 #include "TLorentzVector.h"
 
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
 /**
  * Mixing function for Toy MC events.
  * Checks if any combination of pos + neg muon, where each muon is from a different event results in a dimuon
@@ -36,4 +42,195 @@ std::vector<ToyMCOutEvent> ToyMCMixFunction(const ToyMCEvent& evi, const ToyMCEv
   return events;
 }
 
+/**
+ * Same as above, but emplacing the output events into a sink (see EventSink.h) instead of returning them.
+ */
+template<typename SinkT>
+void ToyMCMixFunction(const ToyMCEvent& evi, const ToyMCEvent& evj, size_t i, size_t j,
+                      const double massLow, const double massHigh, SinkT& sink)
+{
+  const TLorentzVector posI_negJ = evi.muPos() + evj.muNeg();
+  const TLorentzVector posJ_negI = evi.muNeg() + evj.muPos();
+
+  const double pInJ_mass = posI_negJ.M();
+  const double pJnI_mass = posJ_negI.M();
+
+  if (pInJ_mass > massLow && pInJ_mass < massHigh) {
+    sink.emplace_back(evi.muPos(), evj.muNeg(), posI_negJ, i, j);
+  }
+  if (pJnI_mass > massLow && pJnI_mass < massHigh) {
+    sink.emplace_back(evj.muPos(), evi.muNeg(), posJ_negI, j, i);
+  }
+}
+
+/**
+ * Same as above, but taking the muons of events i and j from an in-memory MuonStore.
+ * The event numbers in the output events are the entries of the events in the input TTree.
+ */
+std::vector<ToyMCOutEvent> ToyMCMixFunction(const MuonStore& store, size_t i, size_t j,
+                                            const double massLow, const double massHigh)
+{
+  const TLorentzVector posI = store.pos().get(i);
+  const TLorentzVector negI = store.neg().get(i);
+  const TLorentzVector posJ = store.pos().get(j);
+  const TLorentzVector negJ = store.neg().get(j);
+
+  TLorentzVector posI_negJ = posI + negJ;
+  TLorentzVector posJ_negI = negI + posJ;
+
+  const double pInJ_mass = posI_negJ.M();
+  const double pJnI_mass = posJ_negI.M();
+
+  std::vector<ToyMCOutEvent> events;
+  events.reserve(2);
+
+  if (pInJ_mass > massLow && pInJ_mass < massHigh) {
+    events.push_back(ToyMCOutEvent(posI, negJ, posI_negJ, store.entry(i), store.entry(j)));
+  }
+  if (pJnI_mass > massLow && pJnI_mass < massHigh) {
+    events.push_back(ToyMCOutEvent(posJ, negI, posJ_negI, store.entry(j), store.entry(i)));
+  }
+
+  return events;
+}
+
+/**
+ * sink version of the in-memory ToyMCMixFunction, mixing event i of storeI with event j of storeJ (which can be
+ * different stores, see CrossEventMixer). The output events in which the positive muon is from event i (j) get
+ * flagsI (flagsJ).
+ */
+template<typename SinkT>
+void ToyMCMixFunction(const MuonStore& storeI, size_t i, const MuonStore& storeJ, size_t j,
+                      const double massLow, const double massHigh, SinkT& sink,
+                      const unsigned flagsI = 0, const unsigned flagsJ = 0)
+{
+  const TLorentzVector posI = storeI.pos().get(i);
+  const TLorentzVector negI = storeI.neg().get(i);
+  const TLorentzVector posJ = storeJ.pos().get(j);
+  const TLorentzVector negJ = storeJ.neg().get(j);
+
+  const TLorentzVector posI_negJ = posI + negJ;
+  const TLorentzVector posJ_negI = negI + posJ;
+
+  const double pInJ_mass = posI_negJ.M();
+  const double pJnI_mass = posJ_negI.M();
+
+  if (pInJ_mass > massLow && pInJ_mass < massHigh) {
+    sink.emplace_back(posI, negJ, posI_negJ, storeI.entry(i), storeJ.entry(j), flagsI);
+  }
+  if (pJnI_mass > massLow && pJnI_mass < massHigh) {
+    sink.emplace_back(posJ, negI, posJ_negI, storeJ.entry(j), storeI.entry(i), flagsJ);
+  }
+}
+
+/** sink version of the in-memory ToyMCMixFunction. */
+template<typename SinkT>
+void ToyMCMixFunction(const MuonStore& store, size_t i, size_t j, const double massLow, const double massHigh,
+                      SinkT& sink)
+{
+  ToyMCMixFunction(store, i, store, j, massLow, massHigh, sink);
+}
+
+/**
+ * Block version of the in-memory ToyMCMixFunction, to be used with EventMixer::mixInMemory and ::mixParallel
+ * (and also usable with EventMixer::mix).
+ * Event i is tested against a whole block of events j with the vectorized massWindowMask kernel, comparing M^2
+ * (without any sqrt) to the squared window for both charge combinations. Output events (and their
+ * TLorentzVectors) are only created for the few pairs with a hit, for which the exact ToyMCMixFunction is called.
+ * Hence the output is identical to calling ToyMCMixFunction for every pair.
+ * The output is emplaced into a sink (or a std::vector<ToyMCOutEvent>), see EventSink.h.
+ * Can also mix events from two different stores (see CrossEventMixer), marking the output with the flags
+ * ToyMCOutEvent::CrossMixed and ToyMCOutEvent::PosFromB.
+ */
+class ToyMCBlockMixFunction {
+public:
+  ToyMCBlockMixFunction(const double massLow, const double massHigh) :
+    m_massLow(massLow), m_massHigh(massHigh), m_window(massLow, massHigh) {;}
+
+  /** single pair version, same as ToyMCMixFunction. */
+  std::vector<ToyMCOutEvent> operator()(const MuonStore& store, size_t i, size_t j) const
+  {
+    return ToyMCMixFunction(store, i, j, m_massLow, m_massHigh);
+  }
+
+  /** version for two events read from the input TTree (see EventMixer::mix), emplacing into a sink. */
+  template<typename SinkT>
+  void operator()(const ToyMCEvent& evi, const ToyMCEvent& evj, size_t i, size_t j, SinkT& sink) const
+  {
+    ToyMCMixFunction(evi, evj, i, j, m_massLow, m_massHigh, sink);
+  }
+
+  /** single pair version emplacing into a sink. */
+  template<typename SinkT>
+  void operator()(const MuonStore& store, size_t i, size_t j, SinkT& sink) const
+  {
+    ToyMCMixFunction(store, i, j, m_massLow, m_massHigh, sink);
+  }
+
+  /** mix event i with all events j in [jBegin, jEnd) and append the output in ascending order of j. */
+  template<typename SinkT>
+  void block(const MuonStore& store, size_t i, size_t jBegin, size_t jEnd, SinkT& sink) const
+  {
+    block(store, i, store, jBegin, jEnd, sink, 0, 0);
+  }
+
+  /** mix event i of storeA with the events [jBegin, jEnd) of storeB (flagging the output as cross mixed). */
+  template<typename SinkT>
+  void block(const MuonStore& storeA, size_t i, const MuonStore& storeB, size_t jBegin, size_t jEnd,
+             SinkT& sink) const
+  {
+    block(storeA, i, storeB, jBegin, jEnd, sink, ToyMCOutEvent::CrossMixed,
+          ToyMCOutEvent::CrossMixed | ToyMCOutEvent::PosFromB);
+  }
+
+private:
+  template<typename SinkT>
+  void block(const MuonStore& storeI, size_t i, const MuonStore& storeJ, size_t jBegin, size_t jEnd, SinkT& sink,
+             const unsigned flagsI, const unsigned flagsJ) const;
+
+  double m_massLow;
+  double m_massHigh;
+  SquaredMassWindow m_window;
+};
+
+template<typename SinkT>
+void ToyMCBlockMixFunction::block(const MuonStore& storeI, size_t i, const MuonStore& storeJ, size_t jBegin,
+                                  size_t jEnd, SinkT& sink, const unsigned flagsI, const unsigned flagsJ) const
+{
+  const FourMomColumns& posI = storeI.pos();
+  const FourMomColumns& negI = storeI.neg();
+  const FourMomColumns& pos = storeJ.pos();
+  const FourMomColumns& neg = storeJ.neg();
+
+  for (size_t begin = jBegin; begin < jEnd; begin += massKernelBlock) {
+    const size_t n = std::min(massKernelBlock, jEnd - begin);
+    // pos(i) + neg(j) and neg(i) + pos(j)
+    uint64_t hits = massWindowMask(posI.px[i], posI.py[i], posI.pz[i], posI.E[i], neg, begin, n, m_window);
+    hits |= massWindowMask(negI.px[i], negI.py[i], negI.pz[i], negI.E[i], pos, begin, n, m_window);
+
+    while (hits) {
+      const size_t k = __builtin_ctzll(hits); // lowest set bit -> ascending j
+      hits &= hits - 1;
+      ToyMCMixFunction(storeI, i, storeJ, begin + k, m_massLow, m_massHigh, sink, flagsI, flagsJ);
+    }
+  }
+}
+
+/**
+ * Bucketing function for EventMixer::mixBucketed, putting ToyMC events into bins of the dimuon rapidity
+ * (with the passed width).
+ */
+class ToyMCRapidityBucket {
+public:
+  ToyMCRapidityBucket(const double width) : m_width(width) {}
+
+  long operator()(const ToyMCEvent& event) const
+  {
+    return long(std::floor((event.muPos() + event.muNeg()).Rapidity() / m_width));
+  }
+
+private:
+  double m_width;
+};
+
 #endif
@@ -0,0 +1,151 @@
+#ifndef EVENTMIXER_TOYMCMIXEDEVENT_H__
+#define EVENTMIXER_TOYMCMIXEDEVENT_H__
+
+#include "ToyMCFlatOutEvent.h"
+#include "../config/MixerSettings.h"
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TLorentzVector.h"
+
+#include <string>
+#include <iostream>
+
+/**
+ * Reader for the output of the EventMixer with ToyMC events, independent of the layout in which it has been
+ * written (ToyMCOutEvent or ToyMCFlatOutEvent in any of its layouts and precisions). Output that only contains the
+ * pair indices (ToyMCIndexOutEvent) has to be read with a PairIndexReader.
+ * Init() detects the layout from the branches of the TTree. After every GetEntry() of the TTree the four-momenta
+ * are available as TLorentzVectors.
+ */
+class ToyMCMixedEvent {
+public:
+  ToyMCMixedEvent() = default;
+
+  ToyMCMixedEvent(const ToyMCMixedEvent&) = delete;
+
+  ToyMCMixedEvent& operator=(const ToyMCMixedEvent&) = delete;
+
+  ~ToyMCMixedEvent();
+
+  void Init(TTree* tree);
+
+  /** layout of the TTree passed to Init(). */
+  config::OutputLayout layout() const { return m_layout; }
+
+  /** true if the flat columns are stored as float. */
+  bool singlePrecision() const { return m_float; }
+
+  TLorentzVector muPos() const { return get(m_muPos, m_muPosD, m_muPosF); }
+
+  TLorentzVector muNeg() const { return get(m_muNeg, m_muNegD, m_muNegF); }
+
+  TLorentzVector dimuon() const { return get(m_dimuon, m_dimuonD, m_dimuonF); }
+
+  unsigned posEvent() const { return m_posEvent; }
+
+  unsigned negEvent() const { return m_negEvent; }
+
+  /** weight of the event (1 for files without a weight branch). */
+  double weight() const { return m_weight; }
+
+  /** flags of the event (see ToyMCOutEvent::Flags, 0 for files without a flags branch). */
+  unsigned flags() const { return m_flags; }
+
+private:
+  TLorentzVector get(const TLorentzVector* p, const FlatFourMom<double>& d, const FlatFourMom<float>& f) const;
+
+  config::OutputLayout m_layout{config::OutputLayout::LorentzVectors};
+
+  bool m_float{false};
+
+  TLorentzVector* m_muPos{new TLorentzVector()};
+
+  TLorentzVector* m_muNeg{new TLorentzVector()};
+
+  TLorentzVector* m_dimuon{new TLorentzVector()};
+
+  FlatFourMom<double> m_muPosD;
+
+  FlatFourMom<double> m_muNegD;
+
+  FlatFourMom<double> m_dimuonD;
+
+  FlatFourMom<float> m_muPosF;
+
+  FlatFourMom<float> m_muNegF;
+
+  FlatFourMom<float> m_dimuonF;
+
+  unsigned m_posEvent{};
+
+  unsigned m_negEvent{};
+
+  double m_weight{1};
+
+  unsigned m_flags{};
+};
+
+ToyMCMixedEvent::~ToyMCMixedEvent()
+{
+  delete m_muPos;
+  delete m_muNeg;
+  delete m_dimuon;
+}
+
+void ToyMCMixedEvent::Init(TTree* tree)
+{
+  const std::string& posName = config::OutputTree.muPosName;
+  const std::string& negName = config::OutputTree.muNegName;
+  const std::string& diMuName = config::OutputTree.diMuName;
+
+  if (tree->GetBranch("nPairs")) {
+    std::cerr << "TTree \'" << tree->GetName() << "\' only contains pair indices. Use a PairIndexReader to read it"
+              << std::endl;
+    return;
+  }
+
+  if (tree->GetBranch(posName.c_str())) {
+    m_layout = config::OutputLayout::LorentzVectors;
+    tree->SetBranchAddress(posName.c_str(), &m_muPos);
+    tree->SetBranchAddress(negName.c_str(), &m_muNeg);
+    tree->SetBranchAddress(diMuName.c_str(), &m_dimuon);
+  } else {
+    m_layout = tree->GetBranch(flatColumnNames(posName, config::OutputLayout::PtEtaPhiM)[0].c_str()) ?
+      config::OutputLayout::PtEtaPhiM : config::OutputLayout::PxPyPzE;
+
+    const std::string firstColumn = flatColumnNames(posName, m_layout)[0];
+    const TLeaf* leaf = tree->GetLeaf(firstColumn.c_str());
+    if (!leaf) {
+      std::cerr << "Could not find the branches of \'" << posName << "\' in any known layout in TTree \'"
+                << tree->GetName() << "\'" << std::endl;
+      return;
+    }
+    m_float = std::string(leaf->GetTypeName()) == "Float_t";
+
+    if (m_float) {
+      m_muPosF.setAddress(tree, posName, m_layout);
+      m_muNegF.setAddress(tree, negName, m_layout);
+      m_dimuonF.setAddress(tree, diMuName, m_layout);
+    } else {
+      m_muPosD.setAddress(tree, posName, m_layout);
+      m_muNegD.setAddress(tree, negName, m_layout);
+      m_dimuonD.setAddress(tree, diMuName, m_layout);
+    }
+  }
+
+  tree->SetBranchAddress("posEventNo", &m_posEvent);
+  tree->SetBranchAddress("negEventNo", &m_negEvent);
+  if (tree->GetBranch("weight")) tree->SetBranchAddress("weight", &m_weight);
+  if (tree->GetBranch("flags")) tree->SetBranchAddress("flags", &m_flags);
+}
+
+TLorentzVector ToyMCMixedEvent::get(const TLorentzVector* p, const FlatFourMom<double>& d,
+                                    const FlatFourMom<float>& f) const
+{
+  if (m_layout == config::OutputLayout::LorentzVectors) return *p;
+  return m_float ? f.get(m_layout) : d.get(m_layout);
+}
+
+#endif
@@ -17,6 +17,31 @@
 class ToyMCOutEvent {
 public:
 
+  /** bits of the flags. */
+  enum Flags : unsigned {
+    CrossMixed = 1, /**< the muons are from two different input samples A and B (see CrossEventMixer). */
+    PosFromB = 2 /**< the positive muon (and posEventNo) is from sample B and the negative one from sample A. */
+  };
+
+  /**
+   * Flat copy of an output event, for buffering output without the heap allocated TLorentzVectors.
+   * Constructible from the same arguments as ToyMCOutEvent and (implicitly) from a ToyMCOutEvent.
+   */
+  struct Record {
+    Record(const TLorentzVector& mPos, const TLorentzVector& mNeg, const TLorentzVector& dimu,
+           unsigned i, unsigned j, unsigned f = 0) :
+      muPos(mPos), muNeg(mNeg), dimuon(dimu), posEvent(i), negEvent(j), flags(f) {;}
+
+    Record(const ToyMCOutEvent& event);
+
+    TLorentzVector muPos;
+    TLorentzVector muNeg;
+    TLorentzVector dimuon;
+    unsigned posEvent;
+    unsigned negEvent;
+    unsigned flags;
+  };
+
   ToyMCOutEvent() = default;
 
   /** constructor from all the necessary information. */
@@ -37,6 +62,9 @@ public:
 
   void Init(TTree* tree);
 
+  /** set the branch addresses of a TTree that has been created by Init() before (e.g. to append to it). */
+  void Attach(TTree* tree);
+
   TLorentzVector& muPos() { return *m_muPos; }
 
   TLorentzVector& muNeg() { return *m_muNeg; }
@@ -47,13 +75,26 @@ public:
 
   void setNegEv(const size_t i) { m_negEvent = i; }
 
+  /**
+   * set all information as in the constructor, but copying into the already existing TLorentzVectors instead of
+   * allocating new ones. Resets the weight to 1.
+   */
+  void set(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+           unsigned i, unsigned j, unsigned flags = 0);
+
+  /** set all information from a Record. */
+  void set(const Record& record);
+
+  /** set the weight of the event (e.g. when only a sample of all pairs is mixed). */
+  void setWeight(const double w) { m_weight = w; }
+
 private:
 
-  TLorentzVector* m_muPos{nullptr};
+  TLorentzVector* m_muPos{new TLorentzVector()};
 
-  TLorentzVector* m_muNeg{nullptr};
+  TLorentzVector* m_muNeg{new TLorentzVector()};
 
-  TLorentzVector* m_dimuon{nullptr};
+  TLorentzVector* m_dimuon{new TLorentzVector()};
 
   unsigned m_posEvent{};
 
@@ -61,6 +102,8 @@ private:
 
   unsigned m_flags{}; /**< storing additional information. */
 
+  double m_weight{1}; /**< event weight. */
+
 };
 
 ToyMCOutEvent::ToyMCOutEvent(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
@@ -70,9 +113,16 @@ ToyMCOutEvent::ToyMCOutEvent(const TLorentzVector& muPos, const TLorentzVector&
   // No-op
 }
 
+ToyMCOutEvent::Record::Record(const ToyMCOutEvent& event)
+  : muPos(*event.m_muPos), muNeg(*event.m_muNeg), dimuon(*event.m_dimuon), posEvent(event.m_posEvent),
+    negEvent(event.m_negEvent), flags(event.m_flags)
+{
+  // No-op
+}
+
 ToyMCOutEvent::ToyMCOutEvent(const ToyMCOutEvent& other)
   : m_muPos(clone(other.m_muPos)), m_muNeg(clone(other.m_muNeg)), m_dimuon(clone(other.m_dimuon)),
-    m_posEvent(other.m_posEvent), m_negEvent(other.m_negEvent), m_flags(other.m_flags)
+    m_posEvent(other.m_posEvent), m_negEvent(other.m_negEvent), m_flags(other.m_flags), m_weight(other.m_weight)
 {
   // Nothing to do here
 }
@@ -86,6 +136,7 @@ void ToyMCOutEvent::swap(ToyMCOutEvent other)
   std::swap(m_posEvent, other.m_posEvent);
   std::swap(m_negEvent, other.m_negEvent);
   std::swap(m_flags, other.m_flags);
+  std::swap(m_weight, other.m_weight);
 }
 
 ToyMCOutEvent& ToyMCOutEvent::operator=(ToyMCOutEvent other)
@@ -95,6 +146,23 @@ ToyMCOutEvent& ToyMCOutEvent::operator=(ToyMCOutEvent other)
   return *this;
 }
 
+void ToyMCOutEvent::set(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+                        unsigned i, unsigned j, unsigned flags)
+{
+  *m_muPos = muPos;
+  *m_muNeg = muNeg;
+  *m_dimuon = dimuon;
+  m_posEvent = i;
+  m_negEvent = j;
+  m_flags = flags;
+  m_weight = 1;
+}
+
+void ToyMCOutEvent::set(const Record& record)
+{
+  set(record.muPos, record.muNeg, record.dimuon, record.posEvent, record.negEvent, record.flags);
+}
+
 ToyMCOutEvent::~ToyMCOutEvent()
 {
   delete m_muPos;
@@ -109,7 +177,19 @@ void ToyMCOutEvent::Init(TTree* tree)
   tree->Branch(config::OutputTree.diMuName.c_str(), &m_dimuon);
   tree->Branch("posEventNo", &m_posEvent);
   tree->Branch("negEventNo", &m_negEvent);
-  // tree->Branch("flags", &m_flags);
+  tree->Branch("weight", &m_weight);
+  tree->Branch("flags", &m_flags);
+}
+
+void ToyMCOutEvent::Attach(TTree* tree)
+{
+  tree->SetBranchAddress(config::OutputTree.muPosName.c_str(), &m_muPos);
+  tree->SetBranchAddress(config::OutputTree.muNegName.c_str(), &m_muNeg);
+  tree->SetBranchAddress(config::OutputTree.diMuName.c_str(), &m_dimuon);
+  tree->SetBranchAddress("posEventNo", &m_posEvent);
+  tree->SetBranchAddress("negEventNo", &m_negEvent);
+  tree->SetBranchAddress("weight", &m_weight);
+  tree->SetBranchAddress("flags", &m_flags);
 }
 
 #endif
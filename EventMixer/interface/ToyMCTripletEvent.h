@@ -0,0 +1,67 @@
+#ifndef EVENTMIXER_TOYMCTRIPLETEVENT_H__
+#define EVENTMIXER_TOYMCTRIPLETEVENT_H__
+
+#include "MiscHelper.h"
+#include "../config/MixerSettings.h"
+
+#include "TTree.h"
+#include "TLorentzVector.h"
+
+#include <memory>
+
+/**
+ * Toy MC input event for the triplet mixing (see TripletMixer).
+ * Provides the 4-vectors of the two single muons and of the photon.
+ */
+class ToyMCTripletEvent {
+public:
+
+  ToyMCTripletEvent() = default;
+
+  ToyMCTripletEvent(const ToyMCTripletEvent& other);
+
+  ToyMCTripletEvent& operator=(const ToyMCTripletEvent&) = delete;
+
+  ~ToyMCTripletEvent();
+
+  void Init(std::unique_ptr<TTree>& tree) { Init(tree.get()); }
+
+  void Init(TTree* tree);
+
+  const TLorentzVector& muPos() const { return *m_muPos; }
+
+  const TLorentzVector& muNeg() const { return *m_muNeg; }
+
+  const TLorentzVector& photon() const { return *m_photon; }
+
+private:
+
+  TLorentzVector* m_muPos{new TLorentzVector()};
+
+  TLorentzVector* m_muNeg{new TLorentzVector()};
+
+  TLorentzVector* m_photon{new TLorentzVector()};
+
+};
+
+void ToyMCTripletEvent::Init(TTree* tree)
+{
+  tree->SetBranchAddress(config::InputTree.muNegName.c_str(), &m_muNeg);
+  tree->SetBranchAddress(config::InputTree.muPosName.c_str(), &m_muPos);
+  tree->SetBranchAddress(config::TripletMixing.photonName.c_str(), &m_photon);
+}
+
+ToyMCTripletEvent::ToyMCTripletEvent(const ToyMCTripletEvent& other)
+  : m_muPos(clone(other.m_muPos)), m_muNeg(clone(other.m_muNeg)), m_photon(clone(other.m_photon))
+{
+  // Nothing to do here
+}
+
+ToyMCTripletEvent::~ToyMCTripletEvent()
+{
+  delete m_muPos;
+  delete m_muNeg;
+  delete m_photon;
+}
+
+#endif
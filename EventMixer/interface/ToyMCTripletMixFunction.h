@@ -0,0 +1,44 @@
+#ifndef EVENTMIXER_TOYMCTRIPLETMIXFUNCTION_H__
+#define EVENTMIXER_TOYMCTRIPLETMIXFUNCTION_H__
+
+#include "MuonStore.h"
+
+#include "TLorentzVector.h"
+
+/**
+ * Triplet mixing function for Toy MC events (see TripletMixer).
+ * Combines the positive muon of event iPos, the negative muon of event jNeg and the photon of event k if the
+ * dimuon mass is in (pairLow, pairHigh) and the dimuon + photon mass is in (massLow, massHigh), and emplaces the
+ * result into the sink with the arguments of ToyMCTripletOutEvent::set.
+ */
+class ToyMCTripletMixFunction {
+public:
+  ToyMCTripletMixFunction(const double pairLow, const double pairHigh, const double massLow, const double massHigh) :
+    m_pairLow(pairLow), m_pairHigh(pairHigh), m_massLow(massLow), m_massHigh(massHigh) {;}
+
+  template<typename SinkT>
+  void operator()(const MuonStore& store, const FourMomColumns& photons, size_t iPos, size_t jNeg, size_t k,
+                  SinkT& sink) const
+  {
+    const TLorentzVector muPos = store.pos().get(iPos);
+    const TLorentzVector muNeg = store.neg().get(jNeg);
+    const TLorentzVector dimuon = muPos + muNeg;
+    const double pairMass = dimuon.M();
+    if (pairMass <= m_pairLow || pairMass >= m_pairHigh) return;
+
+    const TLorentzVector photon = photons.get(k);
+    const TLorentzVector triplet = dimuon + photon;
+    const double mass = triplet.M();
+    if (mass <= m_massLow || mass >= m_massHigh) return;
+
+    sink.emplace_back(muPos, muNeg, photon, dimuon, triplet, store.entry(iPos), store.entry(jNeg), store.entry(k));
+  }
+
+private:
+  double m_pairLow;
+  double m_pairHigh;
+  double m_massLow;
+  double m_massHigh;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef EVENTMIXER_TOYMCTRIPLETOUTEVENT_H__
+#define EVENTMIXER_TOYMCTRIPLETOUTEVENT_H__
+
+#include "../config/MixerSettings.h"
+
+#include "TLorentzVector.h"
+#include "TTree.h"
+
+/**
+ * Output event of the triplet mixing of Toy MC samples (see TripletMixer).
+ * Stores the 4-vectors of the two single muons, the photon, the dimuon and the dimuon + photon, along with the
+ * event numbers from which the muons and the photon were taken in the input TTree.
+ * Not copyable, use the flat Record for buffering output (e.g. in TripletMixer::mixParallel).
+ */
+class ToyMCTripletOutEvent {
+public:
+
+  /** flat copy of an output event, constructible from the same arguments as set. */
+  struct Record {
+    Record(const TLorentzVector& mPos, const TLorentzVector& mNeg, const TLorentzVector& phot,
+           const TLorentzVector& dimu, const TLorentzVector& trip, unsigned i, unsigned j, unsigned k) :
+      muPos(mPos), muNeg(mNeg), photon(phot), dimuon(dimu), triplet(trip), posEvent(i), negEvent(j),
+      photonEvent(k) {;}
+
+    TLorentzVector muPos;
+    TLorentzVector muNeg;
+    TLorentzVector photon;
+    TLorentzVector dimuon;
+    TLorentzVector triplet;
+    unsigned posEvent;
+    unsigned negEvent;
+    unsigned photonEvent;
+  };
+
+  ToyMCTripletOutEvent() = default;
+
+  ToyMCTripletOutEvent(const ToyMCTripletOutEvent&) = delete;
+
+  ToyMCTripletOutEvent& operator=(const ToyMCTripletOutEvent&) = delete;
+
+  ~ToyMCTripletOutEvent();
+
+  void Init(TTree* tree);
+
+  /** set all information, copying into the already existing TLorentzVectors. */
+  void set(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& photon,
+           const TLorentzVector& dimuon, const TLorentzVector& triplet, unsigned i, unsigned j, unsigned k);
+
+  /** set all information from a Record. */
+  void set(const Record& record);
+
+private:
+
+  TLorentzVector* m_muPos{new TLorentzVector()};
+
+  TLorentzVector* m_muNeg{new TLorentzVector()};
+
+  TLorentzVector* m_photon{new TLorentzVector()};
+
+  TLorentzVector* m_dimuon{new TLorentzVector()};
+
+  TLorentzVector* m_triplet{new TLorentzVector()};
+
+  unsigned m_posEvent{};
+
+  unsigned m_negEvent{};
+
+  unsigned m_photonEvent{};
+
+};
+
+ToyMCTripletOutEvent::~ToyMCTripletOutEvent()
+{
+  delete m_muPos;
+  delete m_muNeg;
+  delete m_photon;
+  delete m_dimuon;
+  delete m_triplet;
+}
+
+void ToyMCTripletOutEvent::Init(TTree* tree)
+{
+  tree->Branch(config::OutputTree.muPosName.c_str(), &m_muPos);
+  tree->Branch(config::OutputTree.muNegName.c_str(), &m_muNeg);
+  tree->Branch(config::TripletMixing.photonName.c_str(), &m_photon);
+  tree->Branch(config::TripletMixing.diMuName.c_str(), &m_dimuon);
+  tree->Branch(config::TripletMixing.tripletName.c_str(), &m_triplet);
+  tree->Branch("posEventNo", &m_posEvent);
+  tree->Branch("negEventNo", &m_negEvent);
+  tree->Branch("photonEventNo", &m_photonEvent);
+}
+
+void ToyMCTripletOutEvent::set(const TLorentzVector& muPos, const TLorentzVector& muNeg,
+                               const TLorentzVector& photon, const TLorentzVector& dimuon,
+                               const TLorentzVector& triplet, unsigned i, unsigned j, unsigned k)
+{
+  *m_muPos = muPos;
+  *m_muNeg = muNeg;
+  *m_photon = photon;
+  *m_dimuon = dimuon;
+  *m_triplet = triplet;
+  m_posEvent = i;
+  m_negEvent = j;
+  m_photonEvent = k;
+}
+
+void ToyMCTripletOutEvent::set(const Record& record)
+{
+  set(record.muPos, record.muNeg, record.photon, record.dimuon, record.triplet, record.posEvent,
+      record.negEvent, record.photonEvent);
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef EVENTMIXER_TREEUSERINFO_H__
+#define EVENTMIXER_TREEUSERINFO_H__
+
+#include "TTree.h"
+#include "TList.h"
+#include "TParameter.h"
+#include "TNamed.h"
+
+#include <string>
+
+/**
+ * Store a named integer value in the UserInfo of the tree, which is written together with the TTree header.
+ * Overwrites an already existing value with the same name.
+ */
+void setUserInfoValue(TTree* tree, const std::string& name, const Long64_t value)
+{
+  TList* info = tree->GetUserInfo();
+  auto* param = static_cast<TParameter<Long64_t>*>(info->FindObject(name.c_str()));
+  if (param) {
+    param->SetVal(value);
+  } else {
+    info->Add(new TParameter<Long64_t>(name.c_str(), value));
+  }
+}
+
+/** get a value stored by setUserInfoValue. Returns false if there is no such value. */
+bool getUserInfoValue(TTree* tree, const std::string& name, Long64_t& value)
+{
+  const auto* param = static_cast<TParameter<Long64_t>*>(tree->GetUserInfo()->FindObject(name.c_str()));
+  if (!param) return false;
+  value = param->GetVal();
+  return true;
+}
+
+/** store a named string in the UserInfo of the tree (as title of a TNamed), as setUserInfoValue. */
+void setUserInfoString(TTree* tree, const std::string& name, const std::string& value)
+{
+  TList* info = tree->GetUserInfo();
+  auto* named = static_cast<TNamed*>(info->FindObject(name.c_str()));
+  if (named) {
+    named->SetTitle(value.c_str());
+  } else {
+    info->Add(new TNamed(name.c_str(), value.c_str()));
+  }
+}
+
+/** get a string stored by setUserInfoString. Returns false if there is no such string. */
+bool getUserInfoString(TTree* tree, const std::string& name, std::string& value)
+{
+  const auto* named = static_cast<TNamed*>(tree->GetUserInfo()->FindObject(name.c_str()));
+  if (!named) return false;
+  value = named->GetTitle();
+  return true;
+}
+
+#endif
@@ -0,0 +1,469 @@
+#ifndef EVENTMIXER_TRIPLETMIXER_H__
+#define EVENTMIXER_TRIPLETMIXER_H__
+
+#include "EventMixer.h"
+#include "MuonStore.h"
+#include "PruningIndex.h"
+#include "TiledTriangle.h"
+#include "EventSink.h"
+#include "general/progress.h"
+
+#include "TTree.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TLorentzVector.h"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+namespace mixer_detail {
+  template<typename CondF, typename SinkT>
+  auto mixTriplet(CondF& cond, const MuonStore& store, const FourMomColumns& photons, size_t iPos, size_t jNeg,
+                  size_t k, SinkT& sink, Priority<1>)
+    -> typename std::enable_if<std::is_void<decltype(cond(store, photons, iPos, jNeg, k, sink))>::value>::type
+  {
+    cond(store, photons, iPos, jNeg, k, sink);
+  }
+
+  template<typename CondF, typename SinkT>
+  void mixTriplet(CondF& cond, const MuonStore& store, const FourMomColumns& photons, size_t iPos, size_t jNeg,
+                  size_t k, SinkT& sink, Priority<0>)
+  {
+    for (const auto& event : cond(store, photons, iPos, jNeg, k)) sink.push_back(event);
+  }
+}
+
+/**
+ * Mix the positive muon of event iPos, the negative muon of event jNeg and the photon of event k (all indices into
+ * the store and photons) using cond(store, photons, iPos, jNeg, k, sink) if available and
+ * cond(store, photons, iPos, jNeg, k) (returning a vector) otherwise.
+ */
+template<typename CondF, typename SinkT>
+inline void mixTriplet(CondF& cond, const MuonStore& store, const FourMomColumns& photons, size_t iPos,
+                       size_t jNeg, size_t k, SinkT& sink)
+{
+  mixer_detail::mixTriplet(cond, store, photons, iPos, jNeg, k, sink, mixer_detail::Priority<1>());
+}
+
+/**
+ * Kinematic pruning of the triplet search, for a cond that only accepts dimuons with a mass in
+ * [pairLow, pairHigh] and dimuon + photon with a mass in [massLow, massHigh].
+ *
+ * Since M(dimuon + photon) >= M(dimuon) (for photons with m^2 >= 0), only pairs with a dimuon mass below
+ * min(pairHigh, massHigh) can be part of a triplet in the window. These are looked up with a PruningIndex over the
+ * MuonStore. For every such dimuon the photons that can complete it to a triplet in the window are looked up with
+ * a PruningIndex over the photons, with the dimuon as fixed four-momentum. As for the pair mixing all bounds are
+ * widened a bit, so that only triplets that cond rejects anyway are skipped.
+ */
+class TripletPruning {
+public:
+  TripletPruning(const MuonStore& store, const FourMomColumns& photons, const double pairLow, const double pairHigh,
+                 const double massLow, const double massHigh) :
+    m_pairs(store, pairLow, std::min(pairHigh, massHigh)), m_legs(photons, massLow, massHigh),
+    m_pairLow2(pairLow > 0 ? pairLow * pairLow * (1 - margin) : -std::numeric_limits<double>::infinity()),
+    m_pairHigh2(std::min(pairHigh, massHigh) * std::min(pairHigh, massHigh) * (1 + margin)) {;}
+
+  /** candidates j for pairs with event i, see PruningIndex::candidates. */
+  bool pairCandidates(const size_t i, const size_t jBegin, const size_t jEnd, std::vector<size_t>& cands) const
+  {
+    return m_pairs.candidates(i, jBegin, jEnd, cands);
+  }
+
+  /** false if the dimuon can not be part of a triplet in the window. */
+  bool pairInWindow(const TLorentzVector& dimuon) const
+  {
+    const double m2 = dimuon.M2();
+    return m2 >= m_pairLow2 && m2 <= m_pairHigh2;
+  }
+
+  /** candidate photons for the dimuon, see PruningIndex::candidates(fixed, cands). */
+  bool photonCandidates(const TLorentzVector& dimuon, std::vector<size_t>& cands) const
+  {
+    return m_legs.candidates(dimuon, cands);
+  }
+
+private:
+  PruningIndex m_pairs;
+
+  PruningIndex m_legs;
+
+  double m_pairLow2; /**< widened squared lower bound on the dimuon mass. */
+
+  double m_pairHigh2; /**< widened squared upper bound on the dimuon mass. */
+
+  static constexpr double margin = 1e-6; /**< relative widening of the squared dimuon mass window. */
+};
+
+/**
+ * Mix the positive muon of event iPos and the negative muon of event jNeg with the photons of all events other
+ * than these two (only with the candidate photons if pruning is not nullptr).
+ */
+template<typename CondF, typename SinkT>
+void mixTripletPhotons(CondF& cond, const MuonStore& store, const FourMomColumns& photons,
+                       const TripletPruning* pruning, size_t iPos, size_t jNeg, std::vector<size_t>& cands,
+                       SinkT& sink)
+{
+  if (pruning) {
+    const TLorentzVector dimuon = store.pos().get(iPos) + store.neg().get(jNeg);
+    if (!pruning->pairInWindow(dimuon)) return;
+    if (pruning->photonCandidates(dimuon, cands)) {
+      for (const size_t k : cands) {
+        if (k != iPos && k != jNeg) mixTriplet(cond, store, photons, iPos, jNeg, k, sink);
+      }
+      return;
+    }
+  }
+
+  for (size_t k = 0; k < photons.size(); ++k) {
+    if (k != iPos && k != jNeg) mixTriplet(cond, store, photons, iPos, jNeg, k, sink);
+  }
+}
+
+/**
+ * Mix event i of the store with the events [jBegin, jEnd) into triplets: for every j both charge assignments
+ * (mu+ from i and mu- from j, then mu+ from j and mu- from i) are combined with the photons of all other events in
+ * ascending order. If pruning is not nullptr only the candidates of the pruning are tried, which gives the same
+ * output as long as cond respects the windows of the pruning.
+ */
+template<typename CondF, typename SinkT>
+void mixTripletRow(CondF& cond, const MuonStore& store, const FourMomColumns& photons,
+                   const TripletPruning* pruning, size_t i, size_t jBegin, size_t jEnd, SinkT& sink)
+{
+  std::vector<size_t> photonCands;
+  const auto mixPair = [&](const size_t j) {
+    mixTripletPhotons(cond, store, photons, pruning, i, j, photonCands, sink);
+    mixTripletPhotons(cond, store, photons, pruning, j, i, photonCands, sink);
+  };
+
+  std::vector<size_t> pairCands;
+  if (pruning && pruning->pairCandidates(i, jBegin, jEnd, pairCands)) {
+    for (const size_t j : pairCands) mixPair(j);
+  } else {
+    for (size_t j = jBegin; j < jEnd; ++j) mixPair(j);
+  }
+}
+
+/**
+ * Mixer for triplets of a positive muon, a negative muon and a photon, each taken from a different event of one
+ * input TTree (e.g. for chi_c -> J/psi gamma background studies).
+ *
+ * The input is read once into a MuonStore and a column of photons (EventT has to provide muPos(), muNeg() and
+ * photon()). The triplets are processed as the pairs of the EventMixer: every pair of events i < j is one cell of
+ * the triangle (processed serially or in parallel tiles, see TiledTriangle.h), and for each pair both charge
+ * assignments are combined with the photons of all other events k. Without pruning these are N (N - 1) (N - 2)
+ * combinations, so for anything but small inputs enablePruning should be used (see TripletPruning).
+ *
+ * The interface of cond has to be equivalent to one of (see mixTriplet):
+ * \code{.cpp}
+ * void cond(const MuonStore& store, const FourMomColumns& photons, size_t iPos, size_t jNeg, size_t k, SinkT& sink);
+ * std::vector<OutEventT> cond(const MuonStore& store, const FourMomColumns& photons, size_t iPos, size_t jNeg,
+ *                             size_t k);
+ * \endcode
+ * where iPos, jNeg and k are indices into the store (and photons), use store.entry() for the input TTree entries.
+ *
+ * Takes ownership of the passed TTree.
+ */
+template<typename EventT, typename OutEventT>
+class TripletMixer {
+public:
+  TripletMixer() = delete;
+
+  TripletMixer(TTree* inTree, const std::string& outFileName, const std::string& outTreeName);
+
+  /** read the first maxEvents events of the input TTree into memory. */
+  void preload(const long int maxEvents = -1);
+
+  /**
+   * Only try triplets that can have a dimuon mass in [pairLow, pairHigh] and a dimuon + photon mass in
+   * [massLow, massHigh] (see TripletPruning). cond has to reject all other triplets.
+   */
+  void enablePruning(const double pairLow, const double pairHigh, const double massLow, const double massHigh);
+
+  /** mix all triplets into the output TTree, in the order of mixTripletRow for i = 0, ..., N - 1. */
+  template<typename CondF>
+  void mixInMemory(CondF cond, const long int maxEvents = -1, const std::string& logfile = "");
+
+  /**
+   * Parallel version of mixInMemory (see processTiledTriangle). cond is called concurrently from several threads.
+   * With settings.deterministic the output is in the same order as for mixInMemory.
+   */
+  template<typename CondF>
+  void mixParallel(CondF cond, const TileSettings& settings, const long int maxEvents = -1,
+                   const std::string& logfile = "");
+
+  /** same as mixInMemory, but putting the output into the sink (see EventMixer::mixToSink). */
+  template<typename CondF, typename SinkT>
+  void mixToSink(CondF cond, SinkT& sink, const long int maxEvents = -1, const std::string& logfile = "");
+
+  /** parallel version of mixToSink, with one copy of sink per thread (see EventMixer::mixParallelToSink). */
+  template<typename CondF, typename SinkT>
+  void mixParallelToSink(CondF cond, SinkT& sink, const TileSettings& settings, const long int maxEvents = -1,
+                         const std::string& logfile = "");
+
+  const MuonStore& store() const { return m_store; }
+
+  const FourMomColumns& photons() const { return m_photons; }
+
+  /** write the output TTree to the output file and close the file. */
+  void writeToFile();
+
+  /** write the sink into the output file instead of the output TTree and close the file. */
+  template<typename SinkT>
+  void writeToFile(const SinkT& sink);
+
+private:
+  /** build the pruning for the current store, if it is enabled and not yet built. */
+  void buildPruning();
+
+  /** print the start of the mixing and return the number of pairs i < j of the preloaded events. */
+  uint64_t announce(const std::string& what) const;
+
+  template<typename CondF, typename SinkT>
+  void mixRow(CondF& cond, const size_t i, const size_t jBegin, const size_t jEnd, SinkT& sink) const
+  {
+    mixTripletRow(cond, m_store, m_photons, m_pruning.get(), i, jBegin, jEnd, sink);
+  }
+
+  EventT m_event;
+
+  OutEventT m_outEvent;
+
+  std::unique_ptr<TTree> m_inTree;
+
+  TTree* m_outTree{nullptr}; /**< Output TTree. for ROOT reasons not a std::unique_ptr. */
+
+  TFile* m_outFile{nullptr}; /**< Output TFile. for ROOT reasons not a std::unique_ptr. */
+
+  MuonStore m_store;
+
+  FourMomColumns m_photons; /**< photon of every event in the store. */
+
+  bool m_prune{false};
+
+  double m_pairLow{};
+
+  double m_pairHigh{};
+
+  double m_massLow{};
+
+  double m_massHigh{};
+
+  std::unique_ptr<TripletPruning> m_pruning;
+};
+
+template<typename EventT, typename OutEventT>
+TripletMixer<EventT, OutEventT>::TripletMixer(TTree* inTree, const std::string& outFileName,
+                                              const std::string& outTreeName)
+  : m_inTree(inTree)
+{
+  m_event.Init(m_inTree);
+
+  m_outFile = new TFile(outFileName.c_str(), "recreate");
+  m_outTree = new TTree(outTreeName.c_str(), "mixed triplets tree");
+  m_outTree->SetDirectory(m_outFile);
+
+  m_outEvent.Init(m_outTree);
+}
+
+template<typename EventT, typename OutEventT>
+void TripletMixer<EventT, OutEventT>::preload(const long int maxEvents)
+{
+  const long int nInput = m_inTree->GetEntries();
+  const size_t nEvents = (maxEvents < 0 || maxEvents > nInput) ? nInput : maxEvents;
+  if (m_store.size() == nEvents) return;
+
+  m_store.clear();
+  m_photons.clear();
+  m_store.reserve(nEvents);
+  m_photons.reserve(nEvents);
+  m_pruning.reset(); // refers to the old content of the store
+
+  std::cout << "Reading " << nEvents << " events into memory" << std::endl;
+  for (size_t i = 0; i < nEvents; ++i) {
+    m_inTree->GetEntry(i);
+    m_store.add(m_event, i);
+    m_photons.push_back(m_event.photon());
+  }
+}
+
+template<typename EventT, typename OutEventT>
+void TripletMixer<EventT, OutEventT>::enablePruning(const double pairLow, const double pairHigh,
+                                                    const double massLow, const double massHigh)
+{
+  m_prune = true;
+  m_pairLow = pairLow;
+  m_pairHigh = pairHigh;
+  m_massLow = massLow;
+  m_massHigh = massHigh;
+  m_pruning.reset();
+}
+
+template<typename EventT, typename OutEventT>
+void TripletMixer<EventT, OutEventT>::buildPruning()
+{
+  if (!m_prune || m_pruning) return;
+  std::cout << "Building pruning index for " << m_pairLow << " < M(mumu) [GeV] < " << m_pairHigh << " and "
+            << m_massLow << " < M(mumugamma) [GeV] < " << m_massHigh << std::endl;
+  m_pruning.reset(new TripletPruning(m_store, m_photons, m_pairLow, m_pairHigh, m_massLow, m_massHigh));
+}
+
+template<typename EventT, typename OutEventT>
+uint64_t TripletMixer<EventT, OutEventT>::announce(const std::string& what) const
+{
+  const uint64_t nEvents = m_store.size();
+  // in long double, since the number of triplets does not fit into 64 bits above about 2.6M events
+  const long double nTriplets = nEvents < 3 ? 0 : static_cast<long double>(nEvents) * (nEvents - 1) * (nEvents - 2);
+  std::cout << "Starting " << what << " of " << nEvents << " events. Possible (input) combinations: " << nTriplets
+            << std::endl;
+  return nTrianglePairs(nEvents);
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void TripletMixer<EventT, OutEventT>::mixInMemory(CondF cond, const long int maxEvents, const std::string& logfile)
+{
+  TreeSink<OutEventT> sink(m_outEvent, m_outTree);
+  mixToSink(cond, sink, maxEvents, logfile);
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename SinkT>
+void TripletMixer<EventT, OutEventT>::mixToSink(CondF cond, SinkT& sink, const long int maxEvents,
+                                                const std::string& logfile)
+{
+  preload(maxEvents);
+  buildPruning();
+  const size_t nEvents = m_store.size();
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  const uint64_t nPairs = announce("triplet mixing");
+  PercentProgress<PrintStyle::ProgressText> progress(nPairs, logstream);
+
+  const size_t sizeBefore = sink.size();
+  uint64_t pairs{};
+  for (size_t i = 0; i + 1 < nEvents; ++i) {
+    mixRow(cond, i, i + 1, nEvents, sink);
+    pairs += nEvents - i - 1;
+    progress(pairs);
+  }
+
+  std::cout << "created " << sink.size() - sizeBefore << " new events from " << pairs << " pairs of events."
+            << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF>
+void TripletMixer<EventT, OutEventT>::mixParallel(CondF cond, const TileSettings& settings,
+                                                  const long int maxEvents, const std::string& logfile)
+{
+  preload(maxEvents);
+  buildPruning();
+  const size_t nEvents = m_store.size();
+  if (nEvents < 2) return;
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  const uint64_t nPairs = announce("parallel triplet mixing on " + std::to_string(settings.nThreads) + " threads");
+  PercentProgress<PrintStyle::ProgressText> progress(nPairs, logstream);
+
+  ROOT::EnableThreadSafety();
+
+  // the pair candidates are looked up per row
+  TileSettings tileSettings = settings;
+  tileSettings.fullRows = tileSettings.fullRows || m_prune;
+
+  size_t mixed{};
+  using RecordT = typename OutputRecord<OutEventT>::type;
+  processTiledTriangle<RecordT>(nEvents, tileSettings,
+                                [this, &cond](size_t i, size_t jBegin, size_t jEnd, std::vector<RecordT>& out) {
+                                  mixRow(cond, i, jBegin, jEnd, out);
+                                },
+                                [this, &mixed](const RecordT& record) {
+                                  mixed++;
+                                  setOutput(m_outEvent, record);
+                                  fillOutput(m_outEvent, m_outTree);
+                                },
+                                progress);
+
+  std::cout << "created " << mixed << " new events from " << nPairs << " pairs of events." << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename CondF, typename SinkT>
+void TripletMixer<EventT, OutEventT>::mixParallelToSink(CondF cond, SinkT& sink, const TileSettings& settings,
+                                                        const long int maxEvents, const std::string& logfile)
+{
+  preload(maxEvents);
+  buildPruning();
+  const size_t nEvents = m_store.size();
+  if (nEvents < 2) return;
+
+  std::ofstream filestream;
+  if (!logfile.empty()) filestream.open(logfile);
+  std::ostream& logstream = logfile.empty() ? std::cout : filestream;
+
+  const uint64_t nPairs = announce("parallel triplet mixing into a sink on " + std::to_string(settings.nThreads) +
+                                   " threads");
+  PercentProgress<PrintStyle::ProgressText> progress(nPairs, logstream);
+
+  ROOT::EnableThreadSafety();
+
+  std::vector<SinkT> threadSinks;
+  threadSinks.reserve(std::max(1u, settings.nThreads));
+  for (unsigned t = 0; t < std::max(1u, settings.nThreads); ++t) threadSinks.emplace_back(sink);
+
+  TileSettings tileSettings = settings;
+  tileSettings.fullRows = tileSettings.fullRows || m_prune;
+
+  processTiles(nEvents, tileSettings,
+               [this, &cond, &threadSinks](size_t i, size_t jBegin, size_t jEnd, unsigned worker) {
+                 mixRow(cond, i, jBegin, jEnd, threadSinks[worker]);
+               },
+               progress);
+
+  size_t mixed{};
+  for (const auto& threadSink : threadSinks) {
+    mixed += threadSink.size();
+    sink.merge(threadSink);
+  }
+
+  std::cout << "created " << mixed << " new events from " << nPairs << " pairs of events." << std::endl;
+  if (!logfile.empty()) filestream.close();
+}
+
+template<typename EventT, typename OutEventT>
+void TripletMixer<EventT, OutEventT>::writeToFile()
+{
+  flushOutput(m_outEvent, m_outTree);
+  m_outFile->cd();
+  m_outTree->Write();
+  m_outFile->Write();
+  m_outFile->Close();
+}
+
+template<typename EventT, typename OutEventT>
+template<typename SinkT>
+void TripletMixer<EventT, OutEventT>::writeToFile(const SinkT& sink)
+{
+  delete m_outTree; // removes it from the output file, so that it is not written
+  m_outTree = nullptr;
+
+  sink.write(m_outFile);
+  m_outFile->Write();
+  m_outFile->Close();
+}
+
+#endif
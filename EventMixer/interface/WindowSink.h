@@ -0,0 +1,144 @@
+#ifndef EVENTMIXER_WINDOWSINK_H__
+#define EVENTMIXER_WINDOWSINK_H__
+
+#include "EventSink.h"
+
+#include "TLorentzVector.h"
+#include "TDirectory.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+#include <cstddef>
+
+/** an (open) dimuon mass window (low, high) in GeV. */
+struct MassWindow {
+  double low;
+  double high;
+
+  bool contains(const double mass) const { return mass > low && mass < high; }
+};
+
+/** the smallest window containing all windows. */
+MassWindow envelope(const std::vector<MassWindow>& windows)
+{
+  MassWindow env{windows.front().low, windows.front().high};
+  for (const auto& w : windows) {
+    env.low = std::min(env.low, w.low);
+    env.high = std::max(env.high, w.high);
+  }
+  return env;
+}
+
+/** human readable description of the window, e.g. for TTree titles. */
+std::string windowTitle(const MassWindow& window)
+{
+  std::stringstream title;
+  title << window.low << " < M [GeV] < " << window.high;
+  return title.str();
+}
+
+/**
+ * Sink (see EventSink.h) that routes every event to the sinks of all mass windows that contain its dimuon mass,
+ * so that several windows can be filled in one pass over all pairs (with a cond that accepts all pairs in the
+ * envelope of the windows). Events outside of all windows are dropped. Takes the same arguments in emplace_back
+ * as ToyMCOutEvent::set, i.e. the dimuon has to be the third argument.
+ *
+ * If SinkT provides them, a WindowSink can also be copied, merged (window by window) and written (every window
+ * into its own directory window_<k>), so that it can be used with EventMixer::mixParallelToSink and
+ * EventMixer::writeToFile(sink).
+ */
+template<typename SinkT>
+class WindowSink {
+public:
+  WindowSink() = delete;
+
+  /** sinks[k] gets the events in windows[k]. */
+  WindowSink(const std::vector<MassWindow>& windows, const std::vector<SinkT>& sinks);
+
+  template<typename... Args>
+  void emplace_back(const TLorentzVector& muPos, const TLorentzVector& muNeg, const TLorentzVector& dimuon,
+                    Args&&... args);
+
+  /** total number of events in all windows (an event in overlapping windows is counted for every window). */
+  size_t size() const;
+
+  void merge(const WindowSink& other);
+
+  /** forward the end of row k to all windows (see endRow in EventSink.h). */
+  void endRow(const size_t k);
+
+  /** take the open events of other window by window (see takeOpen in EventSink.h). */
+  void takeOpen(WindowSink& other);
+
+  void write(TDirectory* dir) const;
+
+  const std::vector<MassWindow>& windows() const { return m_windows; }
+
+  const SinkT& sink(const size_t k) const { return m_sinks[k]; }
+
+private:
+  std::vector<MassWindow> m_windows;
+
+  std::vector<SinkT> m_sinks;
+};
+
+template<typename SinkT>
+WindowSink<SinkT>::WindowSink(const std::vector<MassWindow>& windows, const std::vector<SinkT>& sinks) :
+  m_windows(windows), m_sinks(sinks)
+{
+  if (m_windows.size() != m_sinks.size()) {
+    std::cerr << "Need exactly one sink per mass window for a WindowSink" << std::endl;
+    m_windows.resize(std::min(m_windows.size(), m_sinks.size()));
+  }
+}
+
+template<typename SinkT>
+template<typename... Args>
+void WindowSink<SinkT>::emplace_back(const TLorentzVector& muPos, const TLorentzVector& muNeg,
+                                     const TLorentzVector& dimuon, Args&&... args)
+{
+  const double mass = dimuon.M();
+  for (size_t k = 0; k < m_windows.size(); ++k) {
+    if (m_windows[k].contains(mass)) m_sinks[k].emplace_back(muPos, muNeg, dimuon, args...);
+  }
+}
+
+template<typename SinkT>
+size_t WindowSink<SinkT>::size() const
+{
+  size_t n{};
+  for (const auto& sink : m_sinks) n += sink.size();
+  return n;
+}
+
+template<typename SinkT>
+void WindowSink<SinkT>::merge(const WindowSink& other)
+{
+  for (size_t k = 0; k < m_sinks.size(); ++k) m_sinks[k].merge(other.m_sinks[k]);
+}
+
+template<typename SinkT>
+void WindowSink<SinkT>::endRow(const size_t k)
+{
+  for (auto& sink : m_sinks) ::endRow(sink, k);
+}
+
+template<typename SinkT>
+void WindowSink<SinkT>::takeOpen(WindowSink& other)
+{
+  for (size_t k = 0; k < m_sinks.size(); ++k) ::takeOpen(m_sinks[k], other.m_sinks[k]);
+}
+
+template<typename SinkT>
+void WindowSink<SinkT>::write(TDirectory* dir) const
+{
+  for (size_t k = 0; k < m_sinks.size(); ++k) {
+    TDirectory* windowDir = dir->mkdir(("window_" + std::to_string(k)).c_str(), windowTitle(m_windows[k]).c_str());
+    m_sinks[k].write(windowDir);
+  }
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include "ToyMCMixedEvent.h"
+#include "ToyMCOutEvent.h"
+#include "ToyMCFlatOutEvent.h"
+#include "ToyMCIndexOutEvent.h"
+#include "ToyMCEvent.h"
+#include "PairIndexReader.h"
+#include "EventSink.h"
+
+#include "MixerSettings.h" // in config
+
+#include "TTree.h"
+#include "TFile.h"
+
+#include <iostream>
+#include <string>
+
+/** copy all events of the input TTree into a new TTree in the output file, written with OutEventT. */
+template<typename OutEventT>
+void convert(TTree* inTree, TFile* outFile)
+{
+  ToyMCMixedEvent inEvent;
+  inEvent.Init(inTree);
+
+  outFile->cd();
+  TTree* outTree = new TTree(inTree->GetName(), inTree->GetTitle());
+  outTree->SetDirectory(outFile);
+  OutEventT outEvent;
+  outEvent.Init(outTree);
+
+  const Long64_t nEntries = inTree->GetEntries();
+  for (Long64_t i = 0; i < nEntries; ++i) {
+    inTree->GetEntry(i);
+    outEvent.set(inEvent.muPos(), inEvent.muNeg(), inEvent.dimuon(), inEvent.posEvent(), inEvent.negEvent(),
+                 inEvent.flags());
+    outEvent.setWeight(inEvent.weight());
+    fillOutput(outEvent, outTree);
+  }
+  flushOutput(outEvent, outTree);
+
+  std::cout << "Converted " << nEntries << " events" << std::endl;
+  outTree->Write();
+}
+
+/**
+ * same as above, but for an input TTree that only contains pair indices, whose four-momenta are rebuilt from the
+ * input TTree of the mixing.
+ */
+template<typename OutEventT>
+void convertIndices(TTree* inTree, TTree* mixInputTree, TFile* outFile)
+{
+  PairIndexReader<ToyMCEvent> reader(inTree, mixInputTree);
+
+  outFile->cd();
+  TTree* outTree = new TTree(inTree->GetName(), inTree->GetTitle());
+  outTree->SetDirectory(outFile);
+  OutEventT outEvent;
+  outEvent.Init(outTree);
+
+  const uint64_t nEvents = reader.size();
+  for (uint64_t i = 0; i < nEvents; ++i) {
+    if (!reader.GetEntry(i)) break;
+    outEvent.set(reader.muPos(), reader.muNeg(), reader.dimuon(), reader.posEvent(), reader.negEvent(),
+                 reader.flags());
+    outEvent.setWeight(reader.weight());
+    fillOutput(outEvent, outTree);
+  }
+
+  std::cout << "Converted " << nEvents << " events" << std::endl;
+  outTree->Write();
+}
+
+/**
+ * Convert the output of simpleMixer between the possible layouts (see config::OutputLayout).
+ * The layout of the input is detected automatically, the layout and the precision of the output are taken from
+ * config::OutputFormat. Output with only pair indices can be converted into one of the other layouts, if the input
+ * file of the mixing is passed as well.
+ * Usage: convertMixedOutput input.root output.root [mixingInput.root]
+ */
+int main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    std::cerr << "Need the name of an input and of an output .root file" << std::endl;
+    return 1;
+  }
+
+  TFile* inFile = TFile::Open(argv[1]);
+  if (!inFile || inFile->IsZombie()) {
+    std::cerr << "Could not open file: \'" << argv[1] << "\'" << std::endl;
+    return 1;
+  }
+  TTree* inTree = static_cast<TTree*>(inFile->Get(config::OutputTree.treeName.c_str()));
+  if (!inTree) {
+    std::cerr << "Could not get \'" << config::OutputTree.treeName << "\' from TFile \'" << argv[1] << "\'" << std::endl;
+    return 1;
+  }
+
+  if (inTree->GetBranch("nPairs")) {
+    if (argc < 4 || config::OutputFormat.layout == config::OutputLayout::PairIndices) {
+      std::cerr << "Converting pair indices needs the input file of the mixing and a layout other than PairIndices"
+                << std::endl;
+      return 1;
+    }
+    TFile* mixInFile = TFile::Open(argv[3]);
+    TTree* mixInTree = mixInFile ? static_cast<TTree*>(mixInFile->Get(config::InputTree.treeName.c_str())) : nullptr;
+    if (!mixInTree) {
+      std::cerr << "Could not get \'" << config::InputTree.treeName << "\' from TFile \'" << argv[3] << "\'"
+                << std::endl;
+      return 1;
+    }
+
+    TFile* outFile = new TFile(argv[2], "recreate");
+    if (config::OutputFormat.layout == config::OutputLayout::LorentzVectors) {
+      convertIndices<ToyMCOutEvent>(inTree, mixInTree, outFile);
+    } else if (config::OutputFormat.singlePrecision) {
+      convertIndices<ToyMCFlatOutEvent<float> >(inTree, mixInTree, outFile);
+    } else {
+      convertIndices<ToyMCFlatOutEvent<double> >(inTree, mixInTree, outFile);
+    }
+    outFile->Close();
+    mixInFile->Close();
+    inFile->Close();
+    return 0;
+  }
+
+  TFile* outFile = new TFile(argv[2], "recreate");
+  if (config::OutputFormat.layout == config::OutputLayout::LorentzVectors) {
+    convert<ToyMCOutEvent>(inTree, outFile);
+  } else if (config::OutputFormat.layout == config::OutputLayout::PairIndices) {
+    convert<ToyMCIndexOutEvent>(inTree, outFile);
+  } else if (config::OutputFormat.singlePrecision) {
+    convert<ToyMCFlatOutEvent<float> >(inTree, outFile);
+  } else {
+    convert<ToyMCFlatOutEvent<double> >(inTree, outFile);
+  }
+
+  outFile->Close();
+  inFile->Close();
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "CrossEventMixer.h"
+#include "ToyMCEvent.h"
+#include "ToyMCOutEvent.h"
+#include "ToyMCFlatOutEvent.h"
+#include "ToyMCMixFunction.h"
+
+#include "MixerSettings.h" // in config
+
+#include "TTree.h"
+#include "TFile.h"
+
+#include <iostream>
+#include <string>
+
+/** get the input TTree from the file fileName. Returns nullptr (after printing why) if it is missing or empty. */
+TTree* openInputTree(const std::string& fileName)
+{
+  TFile* file = TFile::Open(fileName.c_str());
+  if (!file || file->IsZombie()) {
+    std::cerr << "Could not open \'" << fileName << "\'" << std::endl;
+    return nullptr;
+  }
+  TTree* tree{nullptr};
+  file->GetObject(config::InputTree.treeName.c_str(), tree);
+  if (!tree || tree->GetEntries() <= 0) {
+    std::cerr << "Could not read any events of \'" << config::InputTree.treeName << "\' from \'" << fileName
+              << "\'" << std::endl;
+    return nullptr;
+  }
+  return tree;
+}
+
+/** mix the two input TTrees and write the output with OutEventT to the file outFileName. */
+template<typename OutEventT>
+void runCrossMixer(TTree* treeA, TTree* treeB, const std::string& outFileName, const double massMin,
+                   const double massMax)
+{
+  CrossEventMixer<ToyMCEvent, OutEventT> mixer(treeA, treeB, outFileName, config::OutputTree.treeName);
+  std::cout << "Mass window in mixing: " << massMin << " < M [GeV] < " << massMax << std::endl;
+
+  CrossMixSettings settings;
+  settings.memoryBudgetMB = config::CrossMixing.memoryBudgetMB;
+  settings.chunkSize = config::CrossMixing.chunkSize;
+  settings.maxEventsA = config::General.maxEvents;
+  settings.maxEventsB = config::General.maxEvents;
+
+  mixer.mix(ToyMCBlockMixFunction(massMin, massMax), settings);
+  mixer.writeToFile();
+}
+
+/**
+ * Mix every event of one ToyMC sample (A) with every event of another one (B).
+ * The flags of the output events mark from which sample the muons are (see ToyMCOutEvent::Flags).
+ * Usage: crossMixer inputA.root inputB.root output.root [massMin massMax]
+ */
+int main(int argc, char* argv[])
+{
+  if (argc < 4) {
+    std::cerr << "Need the names of two input and of an output .root file" << std::endl;
+    return 1;
+  }
+
+  // the pair indices can not tell from which of the two samples an event is (see PairIndexReader)
+  if (config::OutputFormat.layout == config::OutputLayout::PairIndices) {
+    std::cerr << "OutputLayout::PairIndices is not possible with crossMixer" << std::endl;
+    return 1;
+  }
+
+  TTree* treeA = openInputTree(argv[1]);
+  TTree* treeB = openInputTree(argv[2]);
+  if (!treeA || !treeB) return 1;
+
+  const double massMin = argc < 6 ? config::ToyMCMixConditions.massLow : std::atof(argv[4]);
+  const double massMax = argc < 6 ? config::ToyMCMixConditions.massHigh : std::atof(argv[5]);
+
+  if (config::OutputFormat.layout == config::OutputLayout::LorentzVectors) {
+    runCrossMixer<ToyMCOutEvent>(treeA, treeB, argv[3], massMin, massMax);
+  } else if (config::OutputFormat.singlePrecision) {
+    runCrossMixer<ToyMCFlatOutEvent<float> >(treeA, treeB, argv[3], massMin, massMax);
+  } else {
+    runCrossMixer<ToyMCFlatOutEvent<double> >(treeA, treeB, argv[3], massMin, massMax);
+  }
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include "Sharding.h"
+#include "MixCheckpoint.h"
+#include "MixManifest.h"
+
+#include "MixerSettings.h" // in config
+
+#include "general/root_utils.h"
+
+#include "TTree.h"
+#include "TChain.h"
+#include "TFile.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/** ShardInfo and record of the completed loop of one output file of simpleMixer. */
+struct ShardFile {
+  std::string name;
+  ShardInfo info;
+  MixCheckpoint state;
+};
+
+/**
+ * true if the record of the completed loop of the shard covers its full range of pairs [pairBegin, pairEnd), i.e.
+ * all of its pairs have been mixed and the loop has passed the row of its last pair.
+ */
+bool shardComplete(const ShardFile& shard)
+{
+  const ShardInfo& info = shard.info;
+  if (info.pairBegin >= info.pairEnd) return shard.state.trials == 0;
+  const size_t lastRow = trianglePair(info.nEvents, info.pairEnd - 1).first;
+  return shard.state.nEvents == info.nEvents && shard.state.trials == info.pairEnd - info.pairBegin &&
+    shard.state.nextRow > lastRow;
+}
+
+/**
+ * read the ShardInfo and the record of the completed loop (see EventMixer::enableCheckpoints) of all files.
+ * Returns false if one of them is not available for one of the files, i.e. if a shard has not been mixed completely.
+ */
+bool readShards(const std::vector<std::string>& fileNames, std::vector<ShardFile>& shards)
+{
+  for (const auto& name : fileNames) {
+    TFile* file = checkOpenFile(name);
+    if (!file) return false;
+
+    ShardFile shard{name, ShardInfo(), MixCheckpoint()};
+    TTree* tree = checkGetFromFile<TTree>(file, config::OutputTree.treeName);
+    bool valid = tree != nullptr;
+    if (valid && !shard.info.load(tree)) {
+      std::cerr << "\'" << name << "\' contains no information about the mixed shard" << std::endl;
+      valid = false;
+    }
+    if (valid && !shard.state.load(tree)) {
+      std::cerr << "\'" << name << "\' contains no record of a completed mixing of shard " << shard.info.shard
+                << " (the mixing has probably been interrupted)" << std::endl;
+      valid = false;
+    }
+
+    file->Close();
+    delete file;
+    if (!valid) return false;
+    shards.push_back(shard);
+  }
+  return true;
+}
+
+/**
+ * check that the shards are all shards of the same triangle of the same input, each present exactly once and
+ * completely mixed, and that together they cover the N(N-1)/2 pairs of the triangle exactly. Expects the shards
+ * sorted by their index.
+ */
+bool checkShards(const std::vector<ShardFile>& shards)
+{
+  const ShardInfo& first = shards.front().info;
+  if (shards.size() != first.nShards) {
+    std::cerr << "Got " << shards.size() << " files for " << first.nShards << " shards" << std::endl;
+    return false;
+  }
+
+  uint64_t nPairs{};
+  uint64_t nextPair{};
+  for (size_t k = 0; k < shards.size(); ++k) {
+    const ShardInfo& info = shards[k].info;
+    if (info.nEvents != first.nEvents || info.nShards != first.nShards) {
+      std::cerr << "\'" << shards[k].name << "\' has been mixed from " << info.nEvents << " events in "
+                << info.nShards << " shards, but \'" << shards.front().name << "\' from " << first.nEvents
+                << " events in " << first.nShards << " shards" << std::endl;
+      return false;
+    }
+    if (info.shard != k || info.pairBegin != nextPair) {
+      std::cerr << "Shard " << k << " is missing or duplicated (\'" << shards[k].name << "\' is shard "
+                << info.shard << " starting at pair " << info.pairBegin << ")" << std::endl;
+      return false;
+    }
+    if (!shardComplete(shards[k])) {
+      std::cerr << "Shard " << k << " in \'" << shards[k].name << "\' is not complete: " << shards[k].state.trials
+                << " of " << info.pairEnd - info.pairBegin << " combinations mixed" << std::endl;
+      return false;
+    }
+    if (!shards[k].state.sameInput(shards.front().state)) {
+      std::cerr << "\'" << shards[k].name << "\' has been mixed from the input \'" << shards[k].state.inputFiles
+                << "\', but \'" << shards.front().name << "\' from \'" << shards.front().state.inputFiles << "\'"
+                << std::endl;
+      return false;
+    }
+    nPairs += info.pairEnd - info.pairBegin;
+    nextPair = info.pairEnd;
+  }
+
+  if (nPairs != nTrianglePairs(first.nEvents)) {
+    std::cerr << "Shards cover " << nPairs << " (input) combinations, but " << first.nEvents << " events have "
+              << nTrianglePairs(first.nEvents) << std::endl;
+    return false;
+  }
+
+  std::cout << "All " << first.nShards << " shards present. They cover all " << nPairs
+            << " (input) combinations of " << first.nEvents << " events" << std::endl;
+  return true;
+}
+
+/**
+ * Merge the outputs of simpleMixer runs with --shard k --nshards n into one file, that has the same content as
+ * the output of a single unsharded run.
+ * Usage: mergeShards output.root shard0.root shard1.root ...
+ */
+int main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    std::cerr << "Need the name of the output file and of at least one input .root file" << std::endl;
+    return 1;
+  }
+
+  std::vector<ShardFile> shards;
+  if (!readShards(std::vector<std::string>(argv + 2, argv + argc), shards)) return 1;
+
+  // canonical order is the order of the shards
+  std::sort(shards.begin(), shards.end(),
+            [](const ShardFile& a, const ShardFile& b) { return a.info.shard < b.info.shard; });
+  if (!checkShards(shards)) return 1;
+
+  std::vector<std::string> fileNames;
+  for (const auto& shard : shards) fileNames.push_back(shard.name);
+  TChain* chain = createTChain(fileNames, config::OutputTree.treeName);
+
+  // all shards have been checked to be complete, so the merged output covers the whole triangle
+  TFile* outFile = new TFile(argv[1], "recreate");
+  TTree* outTree = chain->CloneTree(-1, "fast");
+  outTree->SetDirectory(outFile);
+
+  // the merged file is the complete triangle, i.e. shard 0 of 1 that has been mixed completely
+  ShardInfo info = shards.front().info;
+  info.shard = 0;
+  info.nShards = 1;
+  info.pairBegin = 0;
+  info.pairEnd = nTrianglePairs(info.nEvents);
+  info.store(outTree);
+
+  MixCheckpoint state;
+  state.nEvents = info.nEvents;
+  state.nextRow = info.nEvents;
+  state.mixed = outTree->GetEntries();
+  state.trials = info.pairEnd;
+  state.outEntries = outTree->GetEntries();
+  state.inputFiles = shards.front().state.inputFiles;
+  state.inputEntries = shards.front().state.inputEntries;
+  state.store(outTree);
+
+  MixManifest manifest;
+  manifest.end = info.nEvents;
+  manifest.store(outTree);
+
+  std::cout << "Merged " << outTree->GetEntries() << " events into \'" << argv[1] << "\'" << std::endl;
+  outFile->cd();
+  outTree->Write();
+  outFile->Close();
+
+  return 0;
+}
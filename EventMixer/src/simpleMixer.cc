@@ -1,41 +1,224 @@
 #include "EventMixer.h"
 #include "ToyMCEvent.h"
 #include "ToyMCOutEvent.h"
+#include "ToyMCFlatOutEvent.h"
+#include "ToyMCIndexOutEvent.h"
 #include "ToyMCMixFunction.h"
+#include "HistogramSink.h"
 
 #include "MixerSettings.h" // in config
 
+#include "general/ArgParser.h"
+
 #include "TTree.h"
 #include "TFile.h"
+#include "TChain.h"
 
 #include <iostream>
+#include <string>
 
-/** small main to test and demonstrate the EventMixer class. */
-int main(int argc, char* argv[])
+/** the histograms that are filled instead of the output TTree, if config::OutputHistograms is enabled. */
+std::vector<HistDef> toyMCHistograms(const double massMin, const double massMax)
 {
-  if (argc < 3) {
-    std::cerr << "Need the name of an input and of an output .root file" << std::endl;
-    return 1;
+  return {
+    HistDef("mass", HistAxis{PairVariable::Mass, config::OutputHistograms.nMassBins, massMin, massMax}),
+    HistDef("pt", HistAxis{PairVariable::Pt, 100, 0, 50}),
+    HistDef("rap", HistAxis{PairVariable::Rapidity, 60, -3, 3}),
+    HistDef("cosThPhi_HX", HistAxis{PairVariable::CosThHX, 64, -1, 1}, HistAxis{PairVariable::PhiHX, 36, -180, 180}),
+    HistDef("cosThPhi_CS", HistAxis{PairVariable::CosThCS, 64, -1, 1}, HistAxis{PairVariable::PhiCS, 36, -180, 180})
+  };
+}
+
+/** histograms of toyMCHistograms, with the covariance estimate configured in config::OutputHistograms. */
+HistogramSink toyMCHistogramSink(const double massMin, const double massMax)
+{
+  HistogramSink sink(toyMCHistograms(massMin, massMax));
+  if (!config::OutputHistograms.covariance.empty()) sink.enableCovariance(config::OutputHistograms.covariance);
+  return sink;
+}
+
+/** mix into histograms (in one directory per mass window if there is more than one window). */
+template<typename EventMixerT, typename CondF>
+void mixHistograms(EventMixerT& eventMixer, const CondF& mixFunction, const std::vector<MassWindow>& windows)
+{
+  TileSettings tileSettings;
+  tileSettings.nThreads = config::Parallel.nThreads;
+  tileSettings.tileSize = config::Parallel.tileSize;
+
+  if (windows.size() == 1) {
+    HistogramSink histograms = toyMCHistogramSink(windows[0].low, windows[0].high);
+    if (config::Parallel.nThreads > 1) {
+      eventMixer.mixParallelToSink(mixFunction, histograms, tileSettings, config::General.maxEvents);
+    } else {
+      eventMixer.mixToSink(mixFunction, histograms, config::General.maxEvents);
+    }
+    eventMixer.writeToFile(histograms);
+    return;
+  }
+
+  std::vector<HistogramSink> windowHistograms;
+  windowHistograms.reserve(windows.size());
+  for (const auto& window : windows) windowHistograms.push_back(toyMCHistogramSink(window.low, window.high));
+  WindowSink<HistogramSink> histograms(windows, windowHistograms);
+  if (config::Parallel.nThreads > 1) {
+    eventMixer.mixParallelToSink(mixFunction, histograms, tileSettings, config::General.maxEvents);
+  } else {
+    eventMixer.mixToSink(mixFunction, histograms, config::General.maxEvents);
   }
+  eventMixer.writeToFile(histograms);
+}
 
-  TFile* file = TFile::Open(argv[1]);
-  TTree* tree = static_cast<TTree*>(file->Get(config::InputTree.treeName.c_str()));
+/**
+ * run the mixing with the passed input TTree and write the output with OutEventT to the file outFileName.
+ * If nShards is larger than 1 only the passed shard of the triangle is mixed. If there is more than one mass
+ * window, all of them are mixed in one pass into separate outputs. If appendTo is not empty, only the input events
+ * that have not been mixed into the output appendTo are mixed.
+ * Returns false if resuming from a checkpoint has been refused (see EventMixer::failed).
+ */
+template<typename OutEventT>
+bool runMixer(TTree* tree, const std::string& outFileName, const std::vector<MassWindow>& windows,
+              const unsigned shard, const unsigned nShards, const std::string& appendTo)
+{
+  const double massMin = envelope(windows).low;
+  const double massMax = envelope(windows).high;
 
-  EventMixer<ToyMCEvent, ToyMCOutEvent> eventMixer(tree, argv[2],
-                                                   config::OutputTree.treeName);
+  EventMixer<ToyMCEvent, OutEventT> eventMixer(tree, outFileName,
+                                               config::OutputTree.treeName, config::Checkpoints.resume);
+  // the histograms are only written at the end, so there is nothing to checkpoint
+  if (!config::OutputHistograms.enabled) eventMixer.enableCheckpoints(config::Checkpoints.interval);
   std::cout << "Event mixer initialized" << std::endl;
   std::cout << "Event mixer, starting event loops" << std::endl;
 
-  // if there are enough command line parameters, take them as min and max values for the mass
-  const double massMin = argc < 5 ? config::ToyMCMixConditions.massLow : std::atof(argv[3]);
-  const double massMax = argc < 5 ? config::ToyMCMixConditions.massHigh : std::atof(argv[4]);
-
   std::cout << "Mass window in mixing: " << massMin << " < M [GeV] < " << massMax << std::endl;
-  using namespace std::placeholders;
-  eventMixer.mix(std::bind(ToyMCMixFunction, _1, _2, _3, _4, massMin, massMax), config::General.maxEvents);
-                 // config::Logging.filename);
+  if (config::General.pruneCandidates) eventMixer.enablePruning(massMin, massMax);
+
+  const ToyMCBlockMixFunction mixFunction(massMin, massMax);
+  if (config::OutputHistograms.enabled) {
+    mixHistograms(eventMixer, mixFunction, windows);
+    return true;
+  }
+
+  if (!appendTo.empty()) {
+    eventMixer.mixAppend(mixFunction, appendTo, config::General.maxEvents);
+  } else if (windows.size() > 1) {
+    eventMixer.mixWindows(mixFunction, windows, config::General.maxEvents);
+  } else if (nShards > 1) {
+    eventMixer.mixShard(mixFunction, shard, nShards, config::General.maxEvents);
+  } else if (config::Pooling.enabled) {
+    PoolSettings poolSettings;
+    poolSettings.depth = config::Pooling.depth;
+    eventMixer.mixPool(mixFunction, ToyMCRapidityBucket(config::Bucketing.rapidityWidth), poolSettings,
+                       config::General.maxEvents);
+  } else if (config::Bucketing.enabled) {
+    BucketSettings bucketSettings;
+    if (config::Bucketing.mixNeighbours) bucketSettings.neighbours = {1};
+    eventMixer.mixBucketed(mixFunction, ToyMCRapidityBucket(config::Bucketing.rapidityWidth), bucketSettings,
+                           config::General.maxEvents);
+  } else if (config::Sampling.enabled) {
+    PairSampling sampling;
+    sampling.nSamples = config::Sampling.nSamples;
+    sampling.fraction = config::Sampling.fraction;
+    sampling.seed = config::Sampling.seed;
+    eventMixer.mixSampled(mixFunction, sampling, config::General.maxEvents);
+  } else if (config::Parallel.nThreads > 1) {
+    TileSettings tileSettings;
+    tileSettings.nThreads = config::Parallel.nThreads;
+    tileSettings.tileSize = config::Parallel.tileSize;
+    tileSettings.deterministic = config::Parallel.deterministicOrder;
+    eventMixer.mixParallel(mixFunction, tileSettings, config::General.maxEvents);
+  } else if (config::General.preload) {
+    eventMixer.mixInMemory(mixFunction, config::General.maxEvents);
+  } else {
+    eventMixer.mix(mixFunction, config::General.maxEvents);
+                   // config::Logging.filename);
+  }
 
   eventMixer.writeToFile();
+  return !eventMixer.failed();
+}
+
+/**
+ * small main to test and demonstrate the EventMixer class.
+ * Usage: simpleMixer input.root output.root [massMin massMax [massMin2 massMax2 ...]] [--shard k --nshards n]
+ *        [--append previous_output.root]
+ */
+int main(int argc, char* argv[])
+{
+  // positional arguments come before the first flag
+  int nArgs = 1;
+  while (nArgs < argc && std::string(argv[nArgs]).compare(0, 2, "--")) ++nArgs;
+
+  if (nArgs < 3) {
+    std::cerr << "Need the name of an input and of an output .root file" << std::endl;
+    return 1;
+  }
+
+  const ArgParser parser(argc, argv);
+  const unsigned shard = parser.getOptionVal<unsigned>("--shard", 0);
+  const unsigned nShards = parser.getOptionVal<unsigned>("--nshards", 1);
+  if (shard >= nShards) {
+    std::cerr << "--shard has to be smaller than --nshards" << std::endl;
+    return 1;
+  }
+  const std::string appendTo = parser.getOptionVal<std::string>("--append", "");
+
+  // a chain, so that the input can also be several files (e.g. "input_*.root")
+  TChain* tree = new TChain(config::InputTree.treeName.c_str());
+  if (tree->Add(argv[1]) <= 0 || tree->GetEntries() <= 0) {
+    std::cerr << "Could not read any events of \'" << config::InputTree.treeName << "\' from \'" << argv[1] << "\'"
+              << std::endl;
+    return 1;
+  }
+
+  // if there are enough command line parameters, take them as pairs of min and max values for the mass
+  if ((nArgs - 3) % 2 != 0) {
+    std::cerr << "Need pairs of min and max values for the mass windows, got " << nArgs - 3 << " values" << std::endl;
+    return 1;
+  }
+  std::vector<MassWindow> windows;
+  for (int i = 3; i + 1 < nArgs; i += 2) windows.push_back(MassWindow{std::atof(argv[i]), std::atof(argv[i + 1])});
+  if (windows.empty()) {
+    windows.push_back(MassWindow{config::ToyMCMixConditions.massLow, config::ToyMCMixConditions.massHigh});
+  }
+  if (windows.size() > 1 && nShards > 1) {
+    std::cerr << "Sharding is not possible with more than one mass window" << std::endl;
+    return 1;
+  }
+  if (!appendTo.empty() && (windows.size() > 1 || nShards > 1)) {
+    std::cerr << "--append is only possible with one mass window and without sharding" << std::endl;
+    return 1;
+  }
+  // only the full loops (mix, mixInMemory and mixShard) can continue from a checkpoint
+  const bool fullLoop = appendTo.empty() && windows.size() == 1 && !config::OutputHistograms.enabled &&
+    (nShards > 1 || (!config::Pooling.enabled && !config::Bucketing.enabled && !config::Sampling.enabled &&
+                     config::Parallel.nThreads <= 1));
+  if (config::Checkpoints.resume && !fullLoop) {
+    std::cerr << "Checkpoints.resume is not possible with --append, several mass windows, OutputHistograms, "
+              << "Pooling, Bucketing, Sampling or Parallel.nThreads > 1 (without sharding)" << std::endl;
+    return 1;
+  }
+  if (config::OutputHistograms.enabled) {
+    // the histograms are only filled by mixToSink and mixParallelToSink, that always mix the whole triangle
+    if (nShards > 1 || !appendTo.empty()) {
+      std::cerr << "--shard/--nshards and --append are not possible with OutputHistograms" << std::endl;
+      return 1;
+    }
+    if (config::Sampling.enabled || config::Pooling.enabled || config::Bucketing.enabled) {
+      std::cerr << "Sampling, Pooling and Bucketing are not possible with OutputHistograms" << std::endl;
+      return 1;
+    }
+  }
+
+  bool success;
+  if (config::OutputFormat.layout == config::OutputLayout::LorentzVectors) {
+    success = runMixer<ToyMCOutEvent>(tree, argv[2], windows, shard, nShards, appendTo);
+  } else if (config::OutputFormat.layout == config::OutputLayout::PairIndices) {
+    success = runMixer<ToyMCIndexOutEvent>(tree, argv[2], windows, shard, nShards, appendTo);
+  } else if (config::OutputFormat.singlePrecision) {
+    success = runMixer<ToyMCFlatOutEvent<float> >(tree, argv[2], windows, shard, nShards, appendTo);
+  } else {
+    success = runMixer<ToyMCFlatOutEvent<double> >(tree, argv[2], windows, shard, nShards, appendTo);
+  }
 
-  return 0;
+  return success ? 0 : 1;
 }
@@ -0,0 +1,69 @@
+#include "TripletMixer.h"
+#include "ToyMCTripletEvent.h"
+#include "ToyMCTripletOutEvent.h"
+#include "ToyMCTripletMixFunction.h"
+
+#include "MixerSettings.h" // in config
+
+#include "TTree.h"
+#include "TFile.h"
+
+#include <iostream>
+#include <string>
+
+/** get the input TTree from the file fileName. Returns nullptr (after printing why) if it is missing or empty. */
+TTree* openInputTree(const std::string& fileName)
+{
+  TFile* file = TFile::Open(fileName.c_str());
+  if (!file || file->IsZombie()) {
+    std::cerr << "Could not open \'" << fileName << "\'" << std::endl;
+    return nullptr;
+  }
+  TTree* tree{nullptr};
+  file->GetObject(config::InputTree.treeName.c_str(), tree);
+  if (!tree || tree->GetEntries() <= 0) {
+    std::cerr << "Could not read any events of \'" << config::InputTree.treeName << "\' from \'" << fileName
+              << "\'" << std::endl;
+    return nullptr;
+  }
+  return tree;
+}
+
+/**
+ * Mix the positive muon, the negative muon and the photon of three different events of one ToyMC sample into
+ * chi_c candidates, using the windows of config::TripletMixing.
+ * Usage: tripletMixer input.root output.root
+ */
+int main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    std::cerr << "Need the names of an input and of an output .root file" << std::endl;
+    return 1;
+  }
+
+  TTree* tree = openInputTree(argv[1]);
+  if (!tree) return 1;
+
+  const auto& windows = config::TripletMixing;
+  std::cout << "Mass windows in mixing: " << windows.pairLow << " < M(mumu) [GeV] < " << windows.pairHigh << ", "
+            << windows.massLow << " < M(mumugamma) [GeV] < " << windows.massHigh << std::endl;
+
+  TripletMixer<ToyMCTripletEvent, ToyMCTripletOutEvent> mixer(tree, argv[2], config::OutputTree.treeName);
+  if (config::General.pruneCandidates) {
+    mixer.enablePruning(windows.pairLow, windows.pairHigh, windows.massLow, windows.massHigh);
+  }
+
+  const ToyMCTripletMixFunction mixFunction(windows.pairLow, windows.pairHigh, windows.massLow, windows.massHigh);
+  if (config::Parallel.nThreads > 1) {
+    TileSettings tileSettings;
+    tileSettings.nThreads = config::Parallel.nThreads;
+    tileSettings.tileSize = config::Parallel.tileSize;
+    tileSettings.deterministic = config::Parallel.deterministicOrder;
+    mixer.mixParallel(mixFunction, tileSettings, config::General.maxEvents);
+  } else {
+    mixer.mixInMemory(mixFunction, config::General.maxEvents);
+  }
+  mixer.writeToFile();
+
+  return 0;
+}
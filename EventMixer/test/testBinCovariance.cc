@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include "BinCovariance.h"
+
+#include <vector>
+#include <cstddef>
+
+/** a few pairs of input events with the bin and weight of the mixed event. */
+struct TestPair {
+  size_t i;
+  size_t j;
+  int bin;
+  double w;
+};
+
+const size_t nBins = 4;
+const size_t nEvents = 5;
+const std::vector<TestPair> testPairs = { {0, 1, 0, 1.0}, {0, 2, 1, 0.5}, {0, 3, 1, 2.0}, {1, 2, 3, 1.5},
+                                          {1, 4, 0, 1.0}, {2, 3, 2, 0.25}, {2, 4, 3, 1.0}, {3, 4, 1, 3.0},
+                                          {0, 4, -1, 1.0}, {1, 3, 4, 1.0} }; // the last two are out of range
+
+/** the covariance computed directly from the per event contributions c_k. */
+std::vector<double> directCovariance()
+{
+  std::vector<std::vector<double> > c(nEvents, std::vector<double>(nBins));
+  for (const auto& pair : testPairs) {
+    if (pair.bin < 0 || size_t(pair.bin) >= nBins) continue;
+    c[pair.i][pair.bin] += pair.w;
+    c[pair.j][pair.bin] += pair.w;
+  }
+
+  std::vector<double> mean(nBins);
+  for (const auto& ck : c) {
+    for (size_t b = 0; b < nBins; ++b) mean[b] += ck[b] / nEvents;
+  }
+  std::vector<double> cov(nBins * nBins);
+  for (const auto& ck : c) {
+    for (size_t a = 0; a < nBins; ++a) {
+      for (size_t b = 0; b < nBins; ++b) cov[a * nBins + b] += (ck[a] - mean[a]) * (ck[b] - mean[b]);
+    }
+  }
+  return cov;
+}
+
+void addPair(BinCovariance& cov, const TestPair& pair)
+{
+  cov.add(pair.i, pair.bin, pair.w);
+  cov.add(pair.j, pair.bin, pair.w);
+}
+
+void expectMatrixEq(const std::vector<double>& expected, const std::vector<double>& actual)
+{
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t b = 0; b < expected.size(); ++b) EXPECT_NEAR(expected[b], actual[b], 1e-12) << "element " << b;
+}
+
+/** check that folding all events gives the covariance of the per event contributions. */
+TEST(BinCovarianceTest, serialTest)
+{
+  BinCovariance cov(nBins);
+  for (const auto& pair : testPairs) addPair(cov, pair);
+  for (size_t k = 0; k < nEvents; ++k) cov.fold(k);
+
+  EXPECT_EQ(nEvents, cov.nEvents());
+  expectMatrixEq(directCovariance(), cov.matrix());
+}
+
+/** check that merging the unfolded parts of two copies (filled like two threads) and folding afterwards is the same. */
+TEST(BinCovarianceTest, mergeTest)
+{
+  BinCovariance first(nBins), second(nBins);
+  for (size_t p = 0; p < testPairs.size(); ++p) addPair(p % 2 ? second : first, testPairs[p]);
+
+  first.merge(second);
+  for (size_t k = 0; k < nEvents; ++k) first.fold(k);
+  expectMatrixEq(directCovariance(), first.matrix());
+}
+
+/** check that taking the pending contributions row by row and folding complete events while filling is the same. */
+TEST(BinCovarianceTest, takeTest)
+{
+  BinCovariance shared(nBins);
+  std::vector<BinCovariance> workers(2, BinCovariance(nBins));
+
+  // row i (all pairs (i, j)) is filled by worker i % 2, event i is complete after rows 0 to i
+  for (size_t i = 0; i < nEvents; ++i) {
+    BinCovariance& worker = workers[i % 2];
+    for (const auto& pair : testPairs) {
+      if (pair.i == i) addPair(worker, pair);
+    }
+    shared.take(worker);
+    shared.fold(i);
+  }
+  for (const auto& worker : workers) shared.merge(worker);
+
+  EXPECT_EQ(nEvents, shared.nEvents());
+  expectMatrixEq(directCovariance(), shared.matrix());
+}
+
+int main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
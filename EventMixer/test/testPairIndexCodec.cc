@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+
+#include "PairIndexCodec.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+/** check that zigzag maps small values of both signs to small numbers and that unzigzag inverts it. */
+TEST(PairIndexCodecTest, zigzagTest)
+{
+  EXPECT_EQ(0u, zigzag(0));
+  EXPECT_EQ(1u, zigzag(-1));
+  EXPECT_EQ(2u, zigzag(1));
+  EXPECT_EQ(3u, zigzag(-2));
+
+  const std::vector<int64_t> values = { 0, 1, -1, 63, -64, 64, 1234567, -1234567, std::numeric_limits<int64_t>::max(),
+                                        std::numeric_limits<int64_t>::min() };
+  for (const int64_t v : values) EXPECT_EQ(v, unzigzag(zigzag(v)));
+}
+
+/** check that varints of all sizes are read back and that a truncated varint is detected. */
+TEST(PairIndexCodecTest, varintTest)
+{
+  const std::vector<uint64_t> values = { 0, 1, 127, 128, 16383, 16384, 0xffffffff,
+                                         std::numeric_limits<uint64_t>::max() };
+  for (const uint64_t v : values) {
+    unsigned char buffer[10];
+    const unsigned char* end = putVarint(v, buffer);
+    const unsigned char* in = buffer;
+    uint64_t read;
+    EXPECT_TRUE(getVarint(in, end, read));
+    EXPECT_EQ(v, read);
+    EXPECT_EQ(end, in);
+
+    if (end - buffer > 1) {
+      in = buffer;
+      EXPECT_FALSE(getVarint(in, end - 1, read));
+    }
+  }
+}
+
+/** check that decoding an encoded block gives the sorted input pairs, also for negEvent < posEvent. */
+TEST(PairIndexCodecTest, roundTripTest)
+{
+  std::vector<PairIndex> pairs = { {5, 9, 0}, {0, 1, 3}, {5, 6, 1}, {7, 2, 2}, {0, 4294967295u, 0},
+                                   {4294967295u, 0, 7}, {5, 7, 0}, {100000, 100001, 1} };
+  std::vector<PairIndex> sorted = pairs;
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<unsigned char> bytes(maxPairIndexBytes * pairs.size());
+  const size_t nBytes = encodePairBlock(pairs, bytes.data());
+  EXPECT_LE(nBytes, bytes.size());
+
+  std::vector<PairIndex> decoded;
+  EXPECT_TRUE(decodePairBlock(bytes.data(), nBytes, pairs.size(), decoded));
+  ASSERT_EQ(sorted.size(), decoded.size());
+  for (size_t k = 0; k < sorted.size(); ++k) {
+    EXPECT_EQ(sorted[k].posEvent, decoded[k].posEvent);
+    EXPECT_EQ(sorted[k].negEvent, decoded[k].negEvent);
+    EXPECT_EQ(sorted[k].flags, decoded[k].flags);
+  }
+}
+
+/** check that the pairs of a mixing loop need few bytes and that an empty block round-trips. */
+TEST(PairIndexCodecTest, loopBlockTest)
+{
+  std::vector<PairIndex> pairs;
+  for (unsigned i = 1000; i < 1010; ++i) {
+    for (unsigned j = i + 1; j < 1100; ++j) pairs.push_back(PairIndex{i, j, 1});
+  }
+  const std::vector<PairIndex> input = pairs;
+
+  std::vector<unsigned char> bytes(maxPairIndexBytes * pairs.size());
+  const size_t nBytes = encodePairBlock(pairs, bytes.data());
+  EXPECT_LE(nBytes, 5 * pairs.size());
+
+  std::vector<PairIndex> decoded;
+  EXPECT_TRUE(decodePairBlock(bytes.data(), nBytes, pairs.size(), decoded));
+  ASSERT_EQ(input.size(), decoded.size());
+  for (size_t k = 0; k < input.size(); ++k) {
+    EXPECT_EQ(input[k].posEvent, decoded[k].posEvent);
+    EXPECT_EQ(input[k].negEvent, decoded[k].negEvent);
+  }
+
+  std::vector<PairIndex> empty;
+  EXPECT_EQ(0u, encodePairBlock(empty, bytes.data()));
+  EXPECT_TRUE(decodePairBlock(bytes.data(), 0, 0, decoded));
+  EXPECT_TRUE(decoded.empty());
+}
+
+/** check that missing or superfluous bytes are reported as corrupt input. */
+TEST(PairIndexCodecTest, corruptBlockTest)
+{
+  std::vector<PairIndex> pairs = { {1, 2, 0}, {1, 300, 0}, {2, 3, 1} };
+  std::vector<unsigned char> bytes(maxPairIndexBytes * pairs.size());
+  const size_t nBytes = encodePairBlock(pairs, bytes.data());
+
+  std::vector<PairIndex> decoded;
+  EXPECT_FALSE(decodePairBlock(bytes.data(), nBytes - 1, pairs.size(), decoded));
+  EXPECT_FALSE(decodePairBlock(bytes.data(), nBytes, pairs.size() - 1, decoded));
+  EXPECT_FALSE(decodePairBlock(bytes.data(), nBytes, pairs.size() + 1, decoded));
+}
+
+int main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
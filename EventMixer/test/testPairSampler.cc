@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+
+#include "PairSampler.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/** check that RandomPermutation maps [0, n) onto itself, for sizes that need cycle-walking and ones that do not. */
+TEST(PairSamplerTest, permutationBijectivityTest)
+{
+  const std::vector<uint64_t> sizes = { 1, 2, 3, 4, 5, 15, 16, 17, 1000, 4096, 4097, 65535 };
+  for (const uint64_t n : sizes) {
+    for (const uint64_t seed : { 0, 42, 12345 }) {
+      const RandomPermutation permutation(n, seed);
+      std::vector<char> hit(n);
+      for (uint64_t x = 0; x < n; ++x) {
+        const uint64_t y = permutation(x);
+        ASSERT_LT(y, n);
+        EXPECT_FALSE(hit[y]) << "n = " << n << ", seed = " << seed << ": " << y << " hit twice";
+        hit[y] = 1;
+      }
+    }
+  }
+}
+
+/** check that the same seed gives the same permutation and another one (almost surely) a different one. */
+TEST(PairSamplerTest, permutationSeedTest)
+{
+  const uint64_t n = 1000;
+  const RandomPermutation a(n, 42), b(n, 42), c(n, 43);
+  size_t nDifferent{};
+  for (uint64_t x = 0; x < n; ++x) {
+    EXPECT_EQ(a(x), b(x));
+    nDifferent += a(x) != c(x);
+  }
+  EXPECT_GT(nDifferent, n / 2);
+}
+
+/** check that the chunks of a PairSampleStream are sorted, disjoint and together have the requested size. */
+TEST(PairSamplerTest, sampleStreamTest)
+{
+  const uint64_t nEvents = 200;
+  PairSampling settings;
+  settings.nSamples = 5000;
+  settings.chunkSize = 700;
+
+  PairSampleStream samples(nEvents, settings);
+  EXPECT_EQ(nTrianglePairs(nEvents), samples.nPairs());
+  EXPECT_EQ(settings.nSamples, samples.size());
+
+  std::vector<char> hit(samples.nPairs());
+  uint64_t nDrawn{};
+  std::vector<uint64_t> chunk;
+  while (samples.next(chunk)) {
+    EXPECT_LE(chunk.size(), settings.chunkSize);
+    EXPECT_TRUE(std::is_sorted(chunk.begin(), chunk.end()));
+    for (const uint64_t k : chunk) {
+      ASSERT_LT(k, samples.nPairs());
+      EXPECT_FALSE(hit[k]) << "pair " << k << " sampled twice";
+      hit[k] = 1;
+    }
+    nDrawn += chunk.size();
+  }
+  EXPECT_EQ(samples.size(), nDrawn);
+  EXPECT_TRUE(chunk.empty());
+}
+
+/** check that the sample is capped at the number of pairs, i.e. that a fraction of 1 gives all pairs. */
+TEST(PairSamplerTest, fullSampleTest)
+{
+  PairSampling settings;
+  settings.fraction = 1;
+  PairSampleStream samples(50, settings);
+
+  std::vector<uint64_t> all, chunk;
+  while (samples.next(chunk)) all.insert(all.end(), chunk.begin(), chunk.end());
+  ASSERT_EQ(nTrianglePairs(50), all.size());
+  for (uint64_t k = 0; k < all.size(); ++k) EXPECT_EQ(k, all[k]);
+}
+
+int main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
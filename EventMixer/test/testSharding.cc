@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "Sharding.h"
+#include "TiledTriangle.h"
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/** check that trianglePair counts all pairs i < j < n row by row and is the inverse of triangleRowOffset. */
+TEST(ShardingTest, trianglePairTest)
+{
+  for (const uint64_t n : { 2, 3, 4, 7, 100, 1001 }) {
+    uint64_t k{};
+    for (size_t i = 0; i + 1 < n; ++i) {
+      EXPECT_EQ(k, triangleRowOffset(n, i));
+      for (size_t j = i + 1; j < n; ++j, ++k) {
+        const auto pair = trianglePair(n, k);
+        ASSERT_EQ(i, pair.first) << "n = " << n << ", k = " << k;
+        ASSERT_EQ(j, pair.second) << "n = " << n << ", k = " << k;
+      }
+    }
+    EXPECT_EQ(nTrianglePairs(n), k);
+  }
+}
+
+/** check the rows around the end of the triangle for a number of events at which double rounding matters. */
+TEST(ShardingTest, trianglePairLargeTest)
+{
+  const uint64_t n = 100000000;
+  for (const uint64_t i : { uint64_t(0), uint64_t(1), n / 2, n - 3, n - 2 }) {
+    const uint64_t offset = triangleRowOffset(n, i);
+    EXPECT_EQ(std::make_pair(size_t(i), size_t(i + 1)), trianglePair(n, offset));
+    EXPECT_EQ(std::make_pair(size_t(i), size_t(n - 1)), trianglePair(n, offset + n - i - 2));
+  }
+  EXPECT_EQ(nTrianglePairs(n) - 1, triangleRowOffset(n, n - 2));
+}
+
+/** check that the shards cover all pairs exactly once, in order and with sizes that differ by at most one. */
+TEST(ShardingTest, shardCoverageTest)
+{
+  for (const uint64_t nEvents : { 0, 1, 2, 3, 10, 1000, 123457 }) {
+    for (const unsigned nShards : { 1, 2, 3, 7, 64, 1000 }) {
+      const uint64_t nPairs = nTrianglePairs(nEvents);
+      uint64_t end{};
+      uint64_t minSize = nPairs, maxSize{};
+      for (unsigned shard = 0; shard < nShards; ++shard) {
+        const auto range = shardPairRange(nEvents, shard, nShards);
+        EXPECT_EQ(end, range.first) << nEvents << " events, shard " << shard << " of " << nShards;
+        EXPECT_LE(range.first, range.second);
+        minSize = std::min(minSize, range.second - range.first);
+        maxSize = std::max(maxSize, range.second - range.first);
+        end = range.second;
+      }
+      EXPECT_EQ(nPairs, end) << nEvents << " events, " << nShards << " shards";
+      EXPECT_LE(maxSize - minSize, 1u) << nEvents << " events, " << nShards << " shards";
+    }
+  }
+}
+
+/** check that the shard boundaries do not overflow for a triangle with more than 2^64 / nShards pairs. */
+TEST(ShardingTest, shardLargeTest)
+{
+  const uint64_t nEvents = uint64_t(1) << 32;
+  const unsigned nShards = 1000;
+  const uint64_t nPairs = nTrianglePairs(nEvents);
+  EXPECT_EQ(0u, shardPairRange(nEvents, 0, nShards).first);
+  EXPECT_EQ(nPairs, shardPairRange(nEvents, nShards - 1, nShards).second);
+  for (unsigned shard = 1; shard < nShards; ++shard) {
+    EXPECT_EQ(shardPairRange(nEvents, shard - 1, nShards).second, shardPairRange(nEvents, shard, nShards).first);
+    EXPECT_LT(shardPairRange(nEvents, shard - 1, nShards).first, shardPairRange(nEvents, shard, nShards).first);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -5,6 +5,7 @@
 #include "effsAndCuts.h"
 
 #include <functional>
+#include <cstddef>
 
 namespace config {
 
@@ -17,6 +18,9 @@ namespace config {
     const double vtxProbJpsi = 0.01; /**< vertex prob cut on Jpsi vertex. */
     const double lifetimeSignificance = 2.0; /**< lifetime significance cut. */
     const double trackPtCut = 1.2; /**< cut on the charged track pT in GeV. */
+    const size_t adaptiveWarmUp = 10000; /**< events to measure all cuts on before ordering them (adaptive cuts). */
+    const size_t adaptiveReorderPeriod = 100000; /**< reorder the cuts every n events (adaptive cuts). */
+    const unsigned adaptiveSamplePeriod = 1000; /**< measure all cuts on every n-th event (adaptive cuts). */
   } JpsiFromBPS; /**< The used settings for the JPsi pre-selection*/
 }
 
@@ -0,0 +1,250 @@
+#ifndef PHYSUTILS_POLUTILS_ADAPTIVECUTSEQUENCE_H__
+#define PHYSUTILS_POLUTILS_ADAPTIVECUTSEQUENCE_H__
+
+#include "CutFlow.h"
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <iostream>
+#include <cstddef>
+
+/**
+ * Sequence of cuts (of a CutFlow) that are applied in the order that minimizes the expected time per event.
+ *
+ * This is only valid for cuts that are independent of the order, i.e. that do nothing but return if an event
+ * passes. The number of events passing all cuts is then the same in every order, but the number of events on which
+ * a cut has been evaluated (and that passed it) in the CutFlow depend on the order.
+ *
+ * On the first warmUp events (and after that on every samplePeriod-th event) all cuts are evaluated once and timed,
+ * to measure the rejection rate r and the time t of every cut. Reading the clock takes about as long as a cut, so
+ * the (calibrated) time of reading the clock is subtracted and t is the sum over all measured events, which averages
+ * out the resolution of the clock. After the warm-up and then every reorderPeriod events the cuts are sorted by
+ * t / r (the optimal order for uncorrelated cuts), so that cheap cuts with a large rejection come first. Cuts that
+ * have not rejected any measured event go last.
+ *
+ * Whether this pays off is measured as well: on every measured event after the warm-up, the times of the cuts that
+ * the original and the current order would have evaluated are added up (which also covers correlated cuts), and the
+ * time of measuring beyond the cuts of the original order is recorded (see netGainNs and printSummary).
+ *
+ * An AdaptiveCutSequence must not be used on several threads at the same time. Use one copy per thread instead.
+ */
+template<typename EventT>
+class AdaptiveCutSequence {
+public:
+  AdaptiveCutSequence(const size_t warmUp, const size_t reorderPeriod, const unsigned samplePeriod) :
+    m_warmUp(warmUp), m_reorderPeriod(reorderPeriod), m_samplePeriod(samplePeriod), m_nextReorder(warmUp) {;}
+
+  /** add cut (returning true if the event passes), that is counted as cut flowIndex in the CutFlow. */
+  void add(const size_t flowIndex, std::function<bool(const EventT&)> cut);
+
+  /** apply all cuts to the event, counting them in cutFlow. Returns true if the event passes all cuts. */
+  bool operator()(const EventT& event, CutFlow& cutFlow);
+
+  /** the indices (in the CutFlow) of the cuts in their current order. */
+  std::vector<size_t> order() const;
+
+  /** mean time (ns) of the cuts per event in the order in which they have been added, on the measured events. */
+  double originalTimeNs() const { return m_nCompared ? m_originalNs / m_nCompared : 0; }
+
+  /** mean time (ns) of the cuts per event in the adapted order, on the measured events after the warm-up. */
+  double adaptedTimeNs() const { return m_nCompared ? m_adaptedNs / m_nCompared : 0; }
+
+  /**
+   * estimated time (ns) per event saved by adapting the order: the difference of the two times above for all events
+   * that have not been measured, minus the time that measuring took longer than the original order. Negative if
+   * adapting the order does not pay off.
+   */
+  double netGainNs() const;
+
+  /** print the order of the cuts and the measured times. */
+  void printSummary(std::ostream& os = std::cout) const;
+
+private:
+  using Clock = std::chrono::high_resolution_clock;
+
+  struct Cut {
+    Cut(const size_t i, std::function<bool(const EventT&)> c) : flowIndex(i), cut(c) {;}
+
+    size_t flowIndex;
+    std::function<bool(const EventT&)> cut;
+    size_t nMeasured{};
+    size_t nRejected{};
+    double timeNs{};
+    bool pass{}; /**< result on the last measured event. */
+    double lastNs{}; /**< time on the last measured event. */
+  };
+
+  /** evaluate and time all cuts on the event. */
+  bool measure(const EventT& event, CutFlow& cutFlow);
+
+  /** time of the cuts that are evaluated on the last measured event, when applying them in order. */
+  double sequenceNs(const std::vector<size_t>& order) const;
+
+  /** time (ns) that reading the clock twice takes, measured once. */
+  static double clockNs();
+
+  /** sort the cuts by their measured time per rejected event. */
+  void reorder();
+
+  std::vector<Cut> m_cuts;
+
+  std::vector<size_t> m_order; /**< indices into m_cuts. */
+
+  size_t m_warmUp;
+
+  size_t m_reorderPeriod;
+
+  unsigned m_samplePeriod;
+
+  size_t m_nEvents{};
+
+  size_t m_nextReorder;
+
+  std::vector<size_t> m_originalOrder; /**< indices into m_cuts in the order in which they have been added. */
+
+  size_t m_nMeasured{}; /**< number of measured events. */
+
+  size_t m_nCompared{}; /**< number of measured events after the warm-up. */
+
+  double m_originalNs{}; /**< summed time of the original order on the measured events after the warm-up. */
+
+  double m_adaptedNs{}; /**< summed time of the adapted order on the measured events after the warm-up. */
+
+  double m_measureExtraNs{}; /**< summed time of measuring minus the time of the original order. */
+};
+
+template<typename EventT>
+void AdaptiveCutSequence<EventT>::add(const size_t flowIndex, std::function<bool(const EventT&)> cut)
+{
+  m_cuts.emplace_back(flowIndex, cut);
+  m_order.push_back(m_order.size());
+  m_originalOrder.push_back(m_originalOrder.size());
+}
+
+template<typename EventT>
+bool AdaptiveCutSequence<EventT>::operator()(const EventT& event, CutFlow& cutFlow)
+{
+  const size_t n = m_nEvents++;
+  if (n == m_nextReorder) {
+    reorder();
+    m_nextReorder += std::max(m_reorderPeriod, size_t(1));
+  }
+  if (n < m_warmUp || (m_samplePeriod && n % m_samplePeriod == 0)) return measure(event, cutFlow);
+
+  for (const size_t i : m_order) {
+    const Cut& cut = m_cuts[i];
+    if (!cutFlow.apply(cut.flowIndex, [&cut, &event]() { return cut.cut(event); })) return false;
+  }
+  return true;
+}
+
+template<typename EventT>
+bool AdaptiveCutSequence<EventT>::measure(const EventT& event, CutFlow& cutFlow)
+{
+  const double clock = clockNs();
+  bool passAll = true;
+  const auto start = Clock::now();
+  auto last = start; // every reading of the clock ends the time of one cut and starts the one of the next
+  for (const size_t i : m_order) {
+    Cut& cut = m_cuts[i];
+    cut.pass = cut.cut(event);
+    const auto now = Clock::now();
+    const double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+    last = now;
+    cut.lastNs = std::max(ns - clock, 0.0);
+    cut.timeNs += cut.lastNs;
+    cut.nMeasured++;
+    cut.nRejected += !cut.pass;
+
+    if (passAll) cutFlow.count(cut.flowIndex, cut.pass); // only count what is evaluated in the current order
+    passAll = passAll && cut.pass;
+  }
+  const double totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(last - start).count();
+
+  const double originalNs = sequenceNs(m_originalOrder);
+  m_nMeasured++;
+  m_measureExtraNs += totalNs - originalNs;
+  if (m_nEvents > m_warmUp) { // the order has been adapted
+    m_nCompared++;
+    m_originalNs += originalNs;
+    m_adaptedNs += sequenceNs(m_order);
+  }
+
+  return passAll;
+}
+
+template<typename EventT>
+double AdaptiveCutSequence<EventT>::sequenceNs(const std::vector<size_t>& order) const
+{
+  double ns{};
+  for (const size_t i : order) {
+    ns += m_cuts[i].lastNs;
+    if (!m_cuts[i].pass) break;
+  }
+  return ns;
+}
+
+template<typename EventT>
+double AdaptiveCutSequence<EventT>::clockNs()
+{
+  static const double ns = []() {
+    double minNs = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 1000; ++i) {
+      const auto start = Clock::now();
+      const double dt = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+      minNs = std::min(minNs, dt);
+    }
+    return minNs;
+  }();
+  return ns;
+}
+
+template<typename EventT>
+void AdaptiveCutSequence<EventT>::reorder()
+{
+  std::vector<double> costPerRejection(m_cuts.size());
+  for (size_t i = 0; i < m_cuts.size(); ++i) {
+    const Cut& cut = m_cuts[i];
+    costPerRejection[i] = cut.nRejected ? cut.timeNs / cut.nRejected : std::numeric_limits<double>::infinity();
+  }
+  std::stable_sort(m_order.begin(), m_order.end(),
+                   [&costPerRejection](const size_t a, const size_t b) {
+                     return costPerRejection[a] < costPerRejection[b];
+                   });
+}
+
+template<typename EventT>
+std::vector<size_t> AdaptiveCutSequence<EventT>::order() const
+{
+  std::vector<size_t> flowIndices;
+  for (const size_t i : m_order) flowIndices.push_back(m_cuts[i].flowIndex);
+  return flowIndices;
+}
+
+template<typename EventT>
+double AdaptiveCutSequence<EventT>::netGainNs() const
+{
+  if (!m_nEvents) return 0;
+  const double saved = (originalTimeNs() - adaptedTimeNs()) * (m_nEvents - m_nMeasured);
+  return (saved - m_measureExtraNs) / m_nEvents;
+}
+
+template<typename EventT>
+void AdaptiveCutSequence<EventT>::printSummary(std::ostream& os) const
+{
+  os << "Adaptive cuts: " << m_nMeasured << " of " << m_nEvents << " events measured. Order (cut: mean time [ns], "
+     << "rejection rate):\n";
+  for (const size_t i : m_order) {
+    const Cut& cut = m_cuts[i];
+    os << "  " << cut.flowIndex << ": " << (cut.nMeasured ? cut.timeNs / cut.nMeasured : 0) << ", "
+       << (cut.nMeasured ? double(cut.nRejected) / cut.nMeasured : 0) << "\n";
+  }
+  os << "Mean time of the cuts per event [ns]: " << originalTimeNs() << " in the original order, " << adaptedTimeNs()
+     << " in the adapted order (" << m_nCompared << " events). Net gain per event including the measuring [ns]: "
+     << netGainNs() << std::endl;
+}
+
+#endif
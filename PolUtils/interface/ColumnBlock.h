@@ -0,0 +1,325 @@
+#ifndef PHYSUTILS_POLUTILS_COLUMNBLOCK_H__
+#define PHYSUTILS_POLUTILS_COLUMNBLOCK_H__
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TBufferFile.h"
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "RVersion.h"
+#include "Bytes.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include <cstddef>
+
+/** read-only view of n contiguous values (a minimal std::span). */
+template<typename T>
+struct Span {
+  const T* data;
+  size_t n;
+
+  size_t size() const { return n; }
+  const T& operator[](const size_t i) const { return data[i]; }
+  const T* begin() const { return data; }
+  const T* end() const { return data + n; }
+};
+
+/**
+ * A block of consecutive entries of a TTree, stored column-wise (one contiguous array of doubles per column), as
+ * filled by a BlockReader.
+ */
+class ColumnBlock {
+public:
+  /** the column with the passed name. Prints an error and returns an empty span if there is none. */
+  Span<double> operator[](const std::string& name) const;
+
+  Span<double> column(const size_t c) const { return Span<double>{m_columns[c].data(), m_size}; }
+
+  const std::vector<std::string>& names() const { return m_names; }
+
+  /** the (global) entry number of the first entry of the block. */
+  long int firstEntry() const { return m_first; }
+
+  /** number of entries in the block. */
+  size_t size() const { return m_size; }
+
+private:
+  template<typename> friend class BlockReader;
+
+  std::vector<std::string> m_names;
+
+  std::vector<std::vector<double> > m_columns;
+
+  long int m_first{};
+
+  size_t m_size{};
+};
+
+Span<double> ColumnBlock::operator[](const std::string& name) const
+{
+  const auto it = std::find(m_names.begin(), m_names.end(), name);
+  if (it == m_names.end()) {
+    std::cerr << "No column \'" << name << "\' in ColumnBlock" << std::endl;
+    return Span<double>{nullptr, 0};
+  }
+  return column(it - m_names.begin());
+}
+
+/** the columns that a BlockReader reads from a TTree with branches read by InEventT. */
+template<typename InEventT>
+struct BlockColumns {
+  /** a TLorentzVector branch and how to get it from the InEventT after reading it. */
+  struct FourMomentum {
+    std::string branch;
+    std::function<const TLorentzVector&(const InEventT&)> get;
+  };
+
+  /** branches with one number per entry, read into the column with the name of the branch. */
+  std::vector<std::string> flat;
+
+  /** TLorentzVector branches, read into the columns <branch>_px, <branch>_py, <branch>_pz and <branch>_E. */
+  std::vector<FourMomentum> fourMomenta;
+};
+
+/**
+ * Reads blocks of consecutive entries of a TTree (or TChain) into a ColumnBlock.
+ *
+ * Flat branches of Double_t, Float_t or Int_t are read basket by basket with the bulk API of TBranch (for ROOT
+ * versions that have it), i.e. without going through the TTree::GetEntry machinery for every entry. All other
+ * flat branches are read entry by entry (TBranch::GetEntry and TLeaf::GetValue). The four-momenta are stored as
+ * objects, that can not be read in bulk, so their branches are read entry by entry into the InEventT (which needs
+ * to have its branch addresses set already, see InEventT::Init) and split into their components. Since this is
+ * much more expensive, they are only read on request (see readFourMomenta) for the entries that are still needed
+ * after the cuts on the flat columns.
+ *
+ * The branches of all columns are activated by the BlockReader.
+ */
+template<typename InEventT>
+class BlockReader {
+public:
+  BlockReader() = delete;
+
+  BlockReader(TTree* tree, const InEventT& event, const BlockColumns<InEventT>& columns);
+
+  /**
+   * read the flat columns of up to n entries starting at entry begin into block. The block ends early at the end of
+   * the current file of a TChain. Returns the number of entries that have been read (0 in case of an I/O error).
+   * The four-momentum columns are set to 0, use readFourMomenta to fill them.
+   */
+  size_t read(const long int begin, const size_t n, ColumnBlock& block);
+
+  /**
+   * read the four-momentum columns of the entries k of the block for which mask[k] is set. block has to be the block
+   * that has been filled by the last call to read. Returns false in case of an I/O error.
+   */
+  bool readFourMomenta(ColumnBlock& block, const std::vector<char>& mask);
+
+private:
+  enum class LeafType { Double, Float, Int, Other };
+
+  /** flat branch of the current TTree and the basket that has been read last from it. */
+  struct FlatColumn {
+    TBranch* branch{nullptr};
+    LeafType type{LeafType::Other};
+    std::unique_ptr<TBufferFile> buffer{new TBufferFile(TBufferFile::kWrite, 32 * 1024)};
+    char* basketData{nullptr};
+    Long64_t basketBegin{-1};
+    Long64_t basketEnd{-1};
+  };
+
+  /** get the branches of the current TTree (of a TChain). */
+  bool setTree();
+
+  /** read n entries of the column starting at the local entry (in the current TTree) into out. */
+  bool readFlat(FlatColumn& column, const Long64_t local, const size_t n, double* out);
+
+  TTree* m_tree{nullptr};
+
+  const InEventT& m_event;
+
+  BlockColumns<InEventT> m_columns;
+
+  std::vector<FlatColumn> m_flat;
+
+  std::vector<TBranch*> m_fourMomBranches;
+
+  int m_treeNumber{-1};
+
+  Long64_t m_local{-1}; /**< the local entry (in the current TTree) of the first entry of the last read block. */
+};
+
+template<typename InEventT>
+BlockReader<InEventT>::BlockReader(TTree* tree, const InEventT& event, const BlockColumns<InEventT>& columns) :
+  m_tree(tree), m_event(event), m_columns(columns), m_flat(columns.flat.size()),
+  m_fourMomBranches(columns.fourMomenta.size())
+{
+  for (const auto& name : m_columns.flat) m_tree->SetBranchStatus(name.c_str(), true);
+  for (const auto& fourMom : m_columns.fourMomenta) m_tree->SetBranchStatus((fourMom.branch + "*").c_str(), true);
+}
+
+template<typename InEventT>
+bool BlockReader<InEventT>::setTree()
+{
+  TTree* tree = m_tree->GetTree();
+  bool allPresent = true;
+
+  for (size_t c = 0; c < m_flat.size(); ++c) {
+    FlatColumn& column = m_flat[c];
+    column.branch = tree->GetBranch(m_columns.flat[c].c_str());
+    column.type = LeafType::Other;
+    column.basketBegin = column.basketEnd = -1;
+    if (!column.branch) {
+      std::cerr << "No branch \'" << m_columns.flat[c] << "\' in TTree \'" << tree->GetName() << "\'" << std::endl;
+      allPresent = false;
+      continue;
+    }
+
+    TObjArray* leaves = column.branch->GetListOfLeaves();
+    if (column.branch->GetListOfBranches()->GetEntries() || leaves->GetEntries() != 1) continue;
+    const TLeaf* leaf = static_cast<TLeaf*>(leaves->At(0));
+    if (leaf->GetLeafCount() || leaf->GetLenStatic() != 1) continue;
+    const std::string type = leaf->GetTypeName();
+    if (type == "Double_t") column.type = LeafType::Double;
+    else if (type == "Float_t") column.type = LeafType::Float;
+    else if (type == "Int_t") column.type = LeafType::Int;
+  }
+
+  for (size_t f = 0; f < m_fourMomBranches.size(); ++f) {
+    const std::string& name = m_columns.fourMomenta[f].branch;
+    m_fourMomBranches[f] = tree->GetBranch(name.c_str());
+    if (!m_fourMomBranches[f]) {
+      std::cerr << "No branch \'" << name << "\' in TTree \'" << tree->GetName() << "\'" << std::endl;
+      allPresent = false;
+    }
+  }
+
+  return allPresent;
+}
+
+/** convert n values of type T from the (big endian) buffer. */
+template<typename T>
+void fromBuffer(char* buffer, const size_t n, double* out)
+{
+  for (size_t k = 0; k < n; ++k) {
+    T value;
+    frombuf(buffer, &value);
+    out[k] = value;
+  }
+}
+
+template<typename InEventT>
+bool BlockReader<InEventT>::readFlat(FlatColumn& column, const Long64_t local, const size_t n, double* out)
+{
+  size_t done{};
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+  const size_t valueSize = column.type == LeafType::Double ? sizeof(double) : 4;
+  while (column.type != LeafType::Other && done < n) {
+    const Long64_t entry = local + done;
+    if (entry < column.basketBegin || entry >= column.basketEnd) {
+      // the buffer is filled with the whole basket containing entry
+      const Long64_t nBasket = column.branch->GetBulkRead().GetEntriesSerialized(entry, *column.buffer);
+      if (nBasket <= 0) break; // read the rest entry by entry
+      const Long64_t* basketEntry = column.branch->GetBasketEntry();
+      const Long64_t basket = TMath::BinarySearch(Long64_t(column.branch->GetWriteBasket() + 1), basketEntry, entry);
+      column.basketBegin = basketEntry[basket];
+      column.basketEnd = column.basketBegin + nBasket;
+      column.basketData = column.buffer->GetCurrent();
+    }
+
+    const size_t nUse = std::min(n - done, size_t(column.basketEnd - entry));
+    char* data = column.basketData + (entry - column.basketBegin) * valueSize;
+    switch (column.type) {
+    case LeafType::Double: fromBuffer<Double_t>(data, nUse, out + done); break;
+    case LeafType::Float: fromBuffer<Float_t>(data, nUse, out + done); break;
+    case LeafType::Int: fromBuffer<Int_t>(data, nUse, out + done); break;
+    case LeafType::Other: break;
+    }
+    done += nUse;
+  }
+#endif
+
+  const TLeaf* leaf = static_cast<TLeaf*>(column.branch->GetListOfLeaves()->At(0));
+  for (; done < n; ++done) {
+    if (column.branch->GetEntry(local + done) < 0) return false;
+    out[done] = leaf->GetValue(0);
+  }
+  return true;
+}
+
+template<typename InEventT>
+size_t BlockReader<InEventT>::read(const long int begin, const size_t n, ColumnBlock& block)
+{
+  const Long64_t local = m_tree->LoadTree(begin); // sets the branch addresses when a TChain opens a new file
+  if (local < 0) {
+    std::cerr << "I/O error while loading event " << begin << " in TTree \'" << m_tree->GetName() << "\'" << std::endl;
+    return 0;
+  }
+  if (m_tree->GetTreeNumber() != m_treeNumber) {
+    if (!setTree()) return 0;
+    m_treeNumber = m_tree->GetTreeNumber();
+  }
+
+  const size_t nRead = std::min(n, size_t(m_tree->GetTree()->GetEntries() - local));
+
+  if (block.m_names.empty()) {
+    block.m_names = m_columns.flat;
+    for (const auto& fourMom : m_columns.fourMomenta) {
+      for (const char* comp : {"_px", "_py", "_pz", "_E"}) block.m_names.push_back(fourMom.branch + comp);
+    }
+    block.m_columns.resize(block.m_names.size());
+  }
+  for (size_t c = 0; c < block.m_columns.size(); ++c) {
+    if (c < m_flat.size()) block.m_columns[c].resize(nRead);
+    else block.m_columns[c].assign(nRead, 0);
+  }
+  block.m_first = begin;
+  block.m_size = nRead;
+  m_local = local;
+
+  bool readOk = true;
+  for (size_t c = 0; c < m_flat.size(); ++c) {
+    readOk &= readFlat(m_flat[c], local, nRead, block.m_columns[c].data());
+  }
+
+  if (!readOk) {
+    std::cerr << "I/O error while reading events " << begin << " to " << begin + nRead << " in TTree \'"
+              << m_tree->GetName() << "\'" << std::endl;
+    return 0;
+  }
+  return nRead;
+}
+
+template<typename InEventT>
+bool BlockReader<InEventT>::readFourMomenta(ColumnBlock& block, const std::vector<char>& mask)
+{
+  bool readOk = true;
+  for (size_t f = 0; f < m_fourMomBranches.size(); ++f) {
+    double* px = block.m_columns[m_flat.size() + 4 * f].data();
+    double* py = block.m_columns[m_flat.size() + 4 * f + 1].data();
+    double* pz = block.m_columns[m_flat.size() + 4 * f + 2].data();
+    double* E = block.m_columns[m_flat.size() + 4 * f + 3].data();
+    for (size_t k = 0; k < block.m_size; ++k) {
+      if (!mask[k]) continue;
+      readOk &= m_fourMomBranches[f]->GetEntry(m_local + k) >= 0;
+      const TLorentzVector& p = m_columns.fourMomenta[f].get(m_event);
+      px[k] = p.Px();
+      py[k] = p.Py();
+      pz[k] = p.Pz();
+      E[k] = p.E();
+    }
+  }
+
+  if (!readOk) {
+    std::cerr << "I/O error while reading the four-momenta of events " << block.m_first << " to "
+              << block.m_first + block.m_size << " in TTree \'" << m_tree->GetName() << "\'" << std::endl;
+  }
+  return readOk;
+}
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef PHYSUTILS_POLUTILS_CUTFLOW_H__
+#define PHYSUTILS_POLUTILS_CUTFLOW_H__
+
+#include "TH1D.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * Cut flow of a selection with named cuts, that are usually applied in the order in which they are registered
+ * (with add, but see AdaptiveCutSequence).
+ *
+ * For every cut the number of events on which it has been evaluated and the number of events that passed it are
+ * counted. Optionally the time for evaluating a cut is measured on every timingPeriod-th evaluation of the cut.
+ * The counters are atomic, so that one CutFlow can be used on several threads. Alternatively copies of the
+ * CutFlow can be filled on different threads and combined with merge.
+ *
+ * The cut flow can be stored as histogram (see histogram) and as json file (see writeJSON).
+ */
+class CutFlow {
+public:
+  /** name is used for the histogram. timingPeriod = 0 switches off the timing. */
+  CutFlow(const std::string& name, const unsigned timingPeriod = 0) : m_name(name), m_timingPeriod(timingPeriod) {;}
+
+  /** copy the cuts and the current counts. */
+  CutFlow(const CutFlow& other);
+
+  CutFlow& operator=(const CutFlow&) = delete;
+
+  /** register a cut and return its index. All cuts have to be registered before anything is counted. */
+  size_t add(const std::string& cutName);
+
+  /** count an event that enters the selection. Has to be called once per event before the cuts are applied. */
+  void countEvent() { m_nAll.fetch_add(1, std::memory_order_relaxed); }
+
+  /** evaluate cut() as cut i and count the result. */
+  template<typename F>
+  bool apply(const size_t i, F cut);
+
+  /** count an evaluation of cut i (e.g. if it has been evaluated outside of apply). */
+  void count(const size_t i, const bool pass);
+
+  /**
+   * count a block of events (including countEvent for every event), where stages[k] is the number of cuts event k
+   * passed before failing one (or the number of cuts if it passed all). I.e. cut i has been evaluated on all events
+   * with a stage >= i and passed by all events with a stage > i.
+   */
+  void addStages(const std::vector<int>& stages);
+
+  /** add the counts of other, which has to have the same cuts. */
+  void merge(const CutFlow& other);
+
+  size_t nCuts() const { return m_cuts.size(); }
+
+  /** number of events that entered the selection. */
+  size_t all() const { return m_nAll; }
+
+  const std::string& cutName(const size_t i) const { return m_cuts[i]->name; }
+
+  /** the index of the cut with the passed name (nCuts() if there is none). */
+  size_t index(const std::string& cutName) const;
+
+  /** number of events on which cut i has been evaluated. */
+  size_t evaluated(const size_t i) const { return m_cuts[i]->evaluated; }
+
+  size_t passed(const size_t i) const { return m_cuts[i]->passed; }
+
+  size_t failed(const size_t i) const { return evaluated(i) - passed(i); }
+
+  /** fraction of all events that passed cut i. */
+  double efficiency(const size_t i) const;
+
+  /** mean time (in ns) for evaluating cut i. 0 if the timing is off. */
+  double meanTime(const size_t i) const;
+
+  /**
+   * histogram with the number of all events in the first bin and the number of events that passed cut i in bin
+   * i + 2. The bins are labeled with the cut names. The histogram is not attached to any TDirectory.
+   */
+  std::unique_ptr<TH1D> histogram() const;
+
+  /** store the counts, efficiencies and times of all cuts in a json file. */
+  void writeJSON(const std::string& filename) const;
+
+private:
+  using Clock = std::chrono::high_resolution_clock;
+
+  struct Cut {
+    Cut(const std::string& n) : name(n) {;}
+
+    std::string name;
+    std::atomic<size_t> evaluated{0};
+    std::atomic<size_t> passed{0};
+    std::atomic<size_t> nTimed{0};
+    std::atomic<long long> timeNs{0};
+  };
+
+  std::string m_name;
+
+  unsigned m_timingPeriod;
+
+  std::vector<std::unique_ptr<Cut> > m_cuts;
+
+  std::atomic<size_t> m_nAll{0};
+};
+
+CutFlow::CutFlow(const CutFlow& other) : m_name(other.m_name), m_timingPeriod(other.m_timingPeriod)
+{
+  for (const auto& cut : other.m_cuts) add(cut->name);
+  merge(other);
+}
+
+size_t CutFlow::add(const std::string& cutName)
+{
+  m_cuts.emplace_back(new Cut(cutName));
+  return m_cuts.size() - 1;
+}
+
+template<typename F>
+bool CutFlow::apply(const size_t i, F cut)
+{
+  Cut& c = *m_cuts[i];
+  const size_t n = c.evaluated.fetch_add(1, std::memory_order_relaxed);
+  bool pass;
+  if (m_timingPeriod && n % m_timingPeriod == 0) {
+    const auto start = Clock::now();
+    pass = cut();
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    c.timeNs.fetch_add(time, std::memory_order_relaxed);
+    c.nTimed.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    pass = cut();
+  }
+  if (pass) c.passed.fetch_add(1, std::memory_order_relaxed);
+  return pass;
+}
+
+void CutFlow::count(const size_t i, const bool pass)
+{
+  m_cuts[i]->evaluated.fetch_add(1, std::memory_order_relaxed);
+  if (pass) m_cuts[i]->passed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CutFlow::addStages(const std::vector<int>& stages)
+{
+  // number of events reaching (i.e. evaluating) every cut, and the number passing all cuts at the end
+  std::vector<size_t> reached(m_cuts.size() + 1);
+  for (const int stage : stages) {
+    reached[std::min(size_t(std::max(stage, 0)), m_cuts.size())]++;
+  }
+  for (size_t i = m_cuts.size(); i > 0; --i) reached[i - 1] += reached[i];
+
+  for (size_t i = 0; i < m_cuts.size(); ++i) {
+    m_cuts[i]->evaluated.fetch_add(reached[i], std::memory_order_relaxed);
+    m_cuts[i]->passed.fetch_add(reached[i + 1], std::memory_order_relaxed);
+  }
+  m_nAll.fetch_add(stages.size(), std::memory_order_relaxed);
+}
+
+void CutFlow::merge(const CutFlow& other)
+{
+  if (other.m_cuts.size() != m_cuts.size()) {
+    std::cerr << "Cannot merge CutFlows with different cuts" << std::endl;
+    return;
+  }
+  for (size_t i = 0; i < m_cuts.size(); ++i) {
+    const Cut& o = *other.m_cuts[i];
+    m_cuts[i]->evaluated += o.evaluated;
+    m_cuts[i]->passed += o.passed;
+    m_cuts[i]->nTimed += o.nTimed;
+    m_cuts[i]->timeNs += o.timeNs;
+  }
+  m_nAll += other.m_nAll;
+}
+
+size_t CutFlow::index(const std::string& cutName) const
+{
+  for (size_t i = 0; i < m_cuts.size(); ++i) {
+    if (m_cuts[i]->name == cutName) return i;
+  }
+  return m_cuts.size();
+}
+
+double CutFlow::efficiency(const size_t i) const
+{
+  const size_t nAll = all();
+  return nAll ? double(passed(i)) / nAll : 0;
+}
+
+double CutFlow::meanTime(const size_t i) const
+{
+  const size_t nTimed = m_cuts[i]->nTimed;
+  return nTimed ? double(m_cuts[i]->timeNs) / nTimed : 0;
+}
+
+std::unique_ptr<TH1D> CutFlow::histogram() const
+{
+  const int nBins = m_cuts.size() + 1;
+  std::unique_ptr<TH1D> h(new TH1D(m_name.c_str(), "", nBins, 0.0, nBins));
+  h->SetDirectory(nullptr);
+  h->GetXaxis()->SetBinLabel(1, "all");
+  h->SetBinContent(1, all());
+  for (size_t i = 0; i < m_cuts.size(); ++i) {
+    h->GetXaxis()->SetBinLabel(i + 2, m_cuts[i]->name.c_str());
+    h->SetBinContent(i + 2, passed(i));
+  }
+  h->SetEntries(all());
+  return h;
+}
+
+void CutFlow::writeJSON(const std::string& filename) const
+{
+  std::ofstream ofs(filename.c_str(), std::fstream::out);
+  ofs << "{\n\t\"name\": \"" << m_name << "\",\n";
+  ofs << "\t\"all\": " << all() << ",\n";
+  ofs << "\t\"cuts\":\n\t[" << std::endl;
+  for (size_t i = 0; i < m_cuts.size(); ++i) {
+    ofs << "\t\t{";
+    ofs << "\"name\": \"" << m_cuts[i]->name << "\", ";
+    ofs << "\"evaluated\": " << evaluated(i) << ", ";
+    ofs << "\"passed\": " << passed(i) << ", ";
+    ofs << "\"failed\": " << failed(i) << ", ";
+    ofs << "\"efficiency\": " << efficiency(i);
+    if (m_timingPeriod) ofs << ", \"meanTimeNs\": " << meanTime(i);
+    ofs << "}" << (i == m_cuts.size() - 1 ? "": ",") << std::endl; // no comma after last element for valid json
+  }
+
+  ofs << "\t]\n}" << std::endl;
+
+  ofs.close();
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef PHYSUTILS_POLUTILS_FANOUTTTREELOOPER_H__
+#define PHYSUTILS_POLUTILS_FANOUTTTREELOOPER_H__
+
+#include "general/root_utils.h"
+
+#include "general/progress.h"
+
+#include "TTree.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <chrono>
+
+/** one stage of a FanOutTTreeLooper, i.e. a selection with its own output. */
+template<typename InEventT>
+class LoopStage {
+public:
+  LoopStage(const std::string& name) : m_name(name) {;}
+
+  virtual ~LoopStage() = default;
+
+  /** process the current input event and fill the output TTree if it is selected. */
+  virtual void process(const InEventT& inEvent) = 0;
+
+  const std::string& name() const { return m_name; }
+
+  /** number of filled events. */
+  size_t count() const { return m_count; }
+
+protected:
+  size_t m_count{};
+
+private:
+  std::string m_name;
+};
+
+/** LoopStage filling an OutEventT with the cond of TTreeLooper::loop. */
+template<typename InEventT, typename OutEventT, typename CondF>
+class CondLoopStage : public LoopStage<InEventT> {
+public:
+  CondLoopStage(const std::string& name, TTree* outTree, CondF cond) :
+    LoopStage<InEventT>(name), m_outTree(outTree), m_cond(cond)
+  {
+    m_outEvent.Create(m_outTree);
+  }
+
+  void process(const InEventT& inEvent) override
+  {
+    if (m_cond(inEvent, m_outEvent)) {
+      m_outTree->Fill();
+      this->m_count++;
+    }
+  }
+
+private:
+  OutEventT m_outEvent;
+
+  TTree* m_outTree{nullptr};
+
+  CondF m_cond;
+};
+
+/**
+ * Looper that runs several selections (stages) with different outputs on one pass over the input TTree, so that
+ * the input is read only once instead of once per selection. Every stage has its own OutEventT, output TTree
+ * (which is typically in its own TFile, that is handled by the caller as for TTreeLooper) and count.
+ *
+ * The branches of the input TTree are pruned as in TTreeLooper (see pruneUnusedBranches).
+ */
+template<typename InEventT>
+class FanOutTTreeLooper {
+public:
+  FanOutTTreeLooper() = delete;
+
+  FanOutTTreeLooper(TTree* inTree, const bool pruneBranches = true);
+
+  /**
+   * add a stage that fills outTree with OutEventT, if cond(const InEventT&, OutEventT&) returns true (as for
+   * TTreeLooper::loop). The stages are run in the order in which they are added.
+   */
+  template<typename OutEventT, typename CondF>
+  void addStage(const std::string& name, TTree* outTree, CondF cond);
+
+  template<PrintStyle PS = PrintStyle::ProgressBar>
+  void loop(const long int maxEvents = -1);
+
+  const LoopStage<InEventT>& stage(const size_t i) const { return *m_stages[i]; }
+
+  size_t nStages() const { return m_stages.size(); }
+
+private:
+  InEventT m_inEvent;
+
+  TTree* m_inTree{nullptr};
+
+  std::vector<std::unique_ptr<LoopStage<InEventT> > > m_stages;
+};
+
+template<typename InEventT>
+FanOutTTreeLooper<InEventT>::FanOutTTreeLooper(TTree* inTree, const bool pruneBranches) : m_inTree(inTree)
+{
+  m_inEvent.Init(m_inTree);
+  if (pruneBranches) pruneUnusedBranches(m_inTree);
+}
+
+template<typename InEventT>
+template<typename OutEventT, typename CondF>
+void FanOutTTreeLooper<InEventT>::addStage(const std::string& name, TTree* outTree, CondF cond)
+{
+  m_stages.emplace_back(new CondLoopStage<InEventT, OutEventT, CondF>(name, outTree, cond));
+}
+
+template<typename InEventT>
+template<PrintStyle PS>
+void FanOutTTreeLooper<InEventT>::loop(const long int maxEvents)
+{
+  const long int nInputEvents = m_inTree->GetEntries();
+  const size_t nEvents = (maxEvents < 0 || maxEvents > nInputEvents) ? nInputEvents : maxEvents;
+
+  std::cout << "Looping over " << nEvents << " with " << m_stages.size() << " stages\n";
+  auto startTime = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < nEvents; ++i) {
+    if (!checkGetEntry(m_inTree, i)) continue;
+
+    for (auto& stage : m_stages) stage->process(m_inEvent);
+    printProgress<PS>(i, nEvents - 1, startTime); // -1 to reach 100 %
+  }
+
+  for (const auto& stage : m_stages) {
+    std::cout << "number of events in stage \'" << stage->name() << "\': " << stage->count() << " of a total of "
+              << nEvents << " events\n";
+  }
+}
+
+#endif
@@ -6,12 +6,18 @@
 
 #include "config/PreselectionJpsiFromB.h"
 
+#include <vector>
+#include <string>
+
 class JpsiFromBInputEvent {
 public:
   JpsiFromBInputEvent() = default;
 
   void Init(TTree* tree);
 
+  /** the branches of the cheap scalars, that are read first by TTreeLooper::loopCutFirst (see jpsiFromBPreCut). */
+  static std::vector<std::string> cutBranches() { return {"JpsiVprob", "bVprob", "bBPAPVLxyToSigmaxy"}; }
+
   bool triggerDecision() const;
 
   const TLorentzVector& jpsi() const { return *m_jpsi; }
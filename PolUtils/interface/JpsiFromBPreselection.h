@@ -3,63 +3,312 @@
 
 #include "JpsiFromBInputEvent.h"
 #include "JpsiFromBEvent.h"
+#include "ColumnBlock.h"
+#include "CutFlow.h"
+#include "AdaptiveCutSequence.h"
 #include "misc_utils.h"
 
 #include "config/PreselectionJpsiFromB.h"
 #include "config/GeneralJpsiFromB.h"
 
-#include "TH1D.h"
+#include <vector>
+#include <cmath>
 
+/** the cuts of jpsiFromBPreSelection in the order in which they are applied. */
+namespace JpsiFromBCut {
+  enum Index : size_t {
+    VtxProbJpsi, VtxProbB, LifetimeSignificance, JpsiPtMax, TrackPt,
+    JpsiPt, BPt, JpsiRapidity, CowboysSeagulls, JpsiMass, MuonAcceptance,
+    N
+  };
+}
+
+/** CutFlow with all cuts of jpsiFromBPreSelection (as histogram Reco_StatEv). */
+CutFlow jpsiFromBCutFlow(const unsigned timingPeriod = 0)
+{
+  CutFlow cutFlow("Reco_StatEv", timingPeriod);
+  for (const char* name : {"vtxProbJpsi", "vtxProbB", "lifetimeSignificance", "jpsiPtMax", "trackPt",
+                           "jpsiPt", "bPt", "jpsiRapidity", "cowboysSeagulls", "jpsiMass", "muonAcceptance"}) {
+    cutFlow.add(name);
+  }
+  return cutFlow;
+}
+
+/**
+ * evaluate one cut of jpsiFromBPreSelection. Return true if the event passes it.
+ * The cuts are written as negations of the rejecting conditions, so that NaN values pass them (as they did when the
+ * cuts were written as 'if (x < cut) return false;').
+ */
+bool passesJpsiFromBCut(const JpsiFromBCut::Index cut, const JpsiFromBInputEvent& inEvent)
+{
+  switch (cut) {
+  case JpsiFromBCut::VtxProbJpsi: return !(inEvent.JpsiVprob < config::JpsiFromBPS.vtxProbJpsi);
+  case JpsiFromBCut::VtxProbB: return !(inEvent.BvProb < config::JpsiFromBPS.vtxProbB);
+  case JpsiFromBCut::LifetimeSignificance: return !(inEvent.lxyToSigma < config::JpsiFromBPS.lifetimeSignificance);
+  case JpsiFromBCut::JpsiPtMax: return !(inEvent.jpsi().Pt() > 990.0);
+  case JpsiFromBCut::TrackPt: return !(inEvent.track().Pt() < config::JpsiFromBPS.trackPtCut);
+  case JpsiFromBCut::JpsiPt: return !(inEvent.jpsi().Pt() < config::JpsiFromBPS.jpsiPtCut); // 10 GeV dimuon cut
+  case JpsiFromBCut::BPt: return !(inEvent.bPlus().Pt() < config::JpsiFromBPS.bPtCut);
+  case JpsiFromBCut::JpsiRapidity: return !(std::abs(inEvent.jpsi().Rapidity()) > config::Jpsi.absRapMax);
+  case JpsiFromBCut::CowboysSeagulls: {
+    const double deltaPhi = reduceRange(inEvent.muNeg().Phi() - inEvent.muPos().Phi());
+    return !(config::JpsiFromBPS.RejectCowboys && deltaPhi < 0.) &&
+      !(config::JpsiFromBPS.RejectSeagulls && deltaPhi > 0.);
+  }
+  case JpsiFromBCut::JpsiMass: return inRange(inEvent.jpsi().M(), config::Jpsi.massMin, config::Jpsi.massMax);
+  case JpsiFromBCut::MuonAcceptance:
+    return isMuonInAcceptance(inEvent.muPos().Pt(), std::abs(inEvent.muPos().Eta())) &&
+      isMuonInAcceptance(inEvent.muNeg().Pt(), std::abs(inEvent.muNeg().Eta()));
+  case JpsiFromBCut::N: break;
+  }
+  return false;
+}
+
+/** apply the cuts [first, last] of jpsiFromBPreSelection in their fixed order. */
+bool applyJpsiFromBCuts(const JpsiFromBInputEvent& inEvent, CutFlow& cutFlow, const JpsiFromBCut::Index first,
+                        const JpsiFromBCut::Index last)
+{
+  for (size_t i = first; i <= last; ++i) {
+    const auto cut = static_cast<JpsiFromBCut::Index>(i);
+    if (!cutFlow.apply(cut, [cut, &inEvent]() { return passesJpsiFromBCut(cut, inEvent); })) return false;
+  }
+  return true;
+}
+
+/**
+ * cuts of jpsiFromBPreSelection that only need the branches in JpsiFromBInputEvent::cutBranches(). For
+ * TTreeLooper::loopCutFirst (together with jpsiFromBSelectionAfterPreCut).
+ */
+bool jpsiFromBPreCut(const JpsiFromBInputEvent& inEvent, CutFlow& cutFlow)
+{
+  cutFlow.countEvent();
+  return applyJpsiFromBCuts(inEvent, cutFlow, JpsiFromBCut::VtxProbJpsi, JpsiFromBCut::LifetimeSignificance);
+}
+
+/** the cuts of jpsiFromBPreSelection after the ones of jpsiFromBPreCut. Return true if event should be filled. */
+bool jpsiFromBSelectionAfterPreCut(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event, CutFlow& cutFlow)
+{
+  if (!applyJpsiFromBCuts(inEvent, cutFlow, JpsiFromBCut::JpsiPtMax, JpsiFromBCut::MuonAcceptance)) return false;
+
+  // Not here: (Left out for the moment)
+  // * removeEta0p2_0p3
+  // * cutDeltaREllDpt
+
+  event = inEvent;
+  return true;
+}
 
 /** return true if event should be filled. */
-bool jpsiFromBPreSelection(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event, TH1D* Reco_StatEv)
+bool jpsiFromBPreSelection(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event, CutFlow& cutFlow)
+{
+  return jpsiFromBPreCut(inEvent, cutFlow) && jpsiFromBSelectionAfterPreCut(inEvent, event, cutFlow);
+}
+
+/**
+ * AdaptiveCutSequence with the cuts [first, last] of jpsiFromBPreSelection (which are all independent of the order),
+ * with the settings from config::JpsiFromBPS.
+ */
+AdaptiveCutSequence<JpsiFromBInputEvent>
+jpsiFromBAdaptiveCuts(const JpsiFromBCut::Index first = JpsiFromBCut::VtxProbJpsi,
+                      const JpsiFromBCut::Index last = JpsiFromBCut::MuonAcceptance)
+{
+  AdaptiveCutSequence<JpsiFromBInputEvent> cuts(config::JpsiFromBPS.adaptiveWarmUp,
+                                                config::JpsiFromBPS.adaptiveReorderPeriod,
+                                                config::JpsiFromBPS.adaptiveSamplePeriod);
+  for (size_t i = first; i <= last; ++i) {
+    const auto cut = static_cast<JpsiFromBCut::Index>(i);
+    cuts.add(cut, [cut](const JpsiFromBInputEvent& inEvent) { return passesJpsiFromBCut(cut, inEvent); });
+  }
+  return cuts;
+}
+
+/**
+ * jpsiFromBSelectionAfterPreCut with the cuts in the order determined by the adaptiveCuts, which have to contain the
+ * cuts after the ones of jpsiFromBPreCut (see jpsiFromBAdaptiveCuts). For TTreeLooper::loopCutFirst, so that the
+ * cut branches are still read first. Only the cuts after the ones of jpsiFromBPreCut are reordered then.
+ */
+bool jpsiFromBAdaptiveSelectionAfterPreCut(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event,
+                                           AdaptiveCutSequence<JpsiFromBInputEvent>& adaptiveCuts, CutFlow& cutFlow)
 {
-  if (inEvent.JpsiVprob < config::JpsiFromBPS.vtxProbJpsi) return false;
-  if (inEvent.BvProb < config::JpsiFromBPS.vtxProbB) return false;
-  const double jpsiPt = inEvent.jpsi().Pt();
-  if(jpsiPt > 990.0) return false;
+  if (!adaptiveCuts(inEvent, cutFlow)) return false;
 
-  if (inEvent.track().Pt() < config::JpsiFromBPS.trackPtCut) return false;
+  event = inEvent;
+  return true;
+}
 
-  if (inEvent.lxyToSigma < config::JpsiFromBPS.lifetimeSignificance) return false;
+/** jpsiFromBPreSelection with the cuts in the order determined by the adaptiveCuts (see jpsiFromBAdaptiveCuts). */
+bool jpsiFromBAdaptiveSelection(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event,
+                                AdaptiveCutSequence<JpsiFromBInputEvent>& adaptiveCuts, CutFlow& cutFlow)
+{
+  cutFlow.countEvent();
+  if (!adaptiveCuts(inEvent, cutFlow)) return false;
 
-  // count all events
-  Reco_StatEv->Fill(0.5);
+  event = inEvent;
+  return true;
+}
 
-  if (jpsiPt < config::JpsiFromBPS.jpsiPtCut) return false; // 10 GeV dimuon cut
-  if (inEvent.bPlus().Pt() < config::JpsiFromBPS.bPtCut) return false;
-  Reco_StatEv->Fill(1.5);
+/** the columns needed by jpsiFromBBlockPreCut and jpsiFromBBlockSelection, for TTreeLooper::loopBlocks. */
+BlockColumns<JpsiFromBInputEvent> jpsiFromBBlockColumns()
+{
+  using Event = JpsiFromBInputEvent;
+  BlockColumns<Event> columns;
+  columns.flat = Event::cutBranches();
+  columns.fourMomenta = {
+    {"JpsiP", [](const Event& e) -> const TLorentzVector& { return e.jpsi(); }},
+    {"muPosP", [](const Event& e) -> const TLorentzVector& { return e.muPos(); }},
+    {"muNegP", [](const Event& e) -> const TLorentzVector& { return e.muNeg(); }},
+    {"BplusP", [](const Event& e) -> const TLorentzVector& { return e.bPlus(); }},
+    {"trackP", [](const Event& e) -> const TLorentzVector& { return e.track(); }}
+  };
+  return columns;
+}
 
-  const double jpsiAbsRap = std::abs(inEvent.jpsi().Rapidity());
-  if (jpsiAbsRap > config::Jpsi.absRapMax) return false;
+/** pseudo-rapidity of (px, py, pz), calculated in the same way as by TVector3::PseudoRapidity. */
+inline double pseudoRapidity(const double px, const double py, const double pz)
+{
+  const double p = std::sqrt(px * px + py * py + pz * pz);
+  const double cosTheta = p == 0 ? 1.0 : pz / p;
+  if (cosTheta * cosTheta < 1) return -0.5 * std::log((1.0 - cosTheta) / (1.0 + cosTheta));
+  if (pz == 0) return 0;
+  return pz > 0 ? 10e10 : -10e10;
+}
 
-  Reco_StatEv->Fill(2.5);
+/**
+ * Block version of jpsiFromBPreCut for TTreeLooper::loopBlocks (with the columns of jpsiFromBBlockColumns), only
+ * using the flat columns. Counts the events that fail one of its cuts in the cutFlow, the others are counted by
+ * jpsiFromBBlockSelection.
+ */
+void jpsiFromBBlockPreCut(const ColumnBlock& block, std::vector<char>& mask, CutFlow& cutFlow)
+{
+  const size_t n = block.size();
+  const Span<double> jpsiVprob = block["JpsiVprob"];
+  const Span<double> bVprob = block["bVprob"];
+  const Span<double> lxyToSigma = block["bBPAPVLxyToSigmaxy"];
 
-  const double deltaPhi = reduceRange(inEvent.muNeg().Phi() - inEvent.muPos().Phi());
-  if (config::JpsiFromBPS.RejectCowboys && deltaPhi < 0.) return false;
-  if (config::JpsiFromBPS.RejectSeagulls && deltaPhi > 0.) return false;
+  // number of passed cuts of the events that fail one of the cuts (see CutFlow::addStages)
+  std::vector<int> failedStages;
+  for (size_t k = 0; k < n; ++k) {
+    // all cuts of jpsiFromBPreCut, in the order of JpsiFromBCut (negated as in passesJpsiFromBCut for NaN)
+    const bool pass[JpsiFromBCut::JpsiPtMax] = {
+      !(jpsiVprob[k] < config::JpsiFromBPS.vtxProbJpsi), !(bVprob[k] < config::JpsiFromBPS.vtxProbB),
+      !(lxyToSigma[k] < config::JpsiFromBPS.lifetimeSignificance)
+    };
+    int s = 0;
+    while (s < int(JpsiFromBCut::JpsiPtMax) && pass[s]) s++;
+    mask[k] = s == int(JpsiFromBCut::JpsiPtMax);
+    if (!mask[k]) failedStages.push_back(s);
+  }
 
-  Reco_StatEv->Fill(3.5);
+  cutFlow.addStages(failedStages);
+}
 
-  const double jpsiMass = inEvent.jpsi().M();
-  if (!inRange(jpsiMass, config::Jpsi.massMin, config::Jpsi.massMax)) return false;
-  Reco_StatEv->Fill(4.5);
+/**
+ * Block version of jpsiFromBSelectionAfterPreCut for TTreeLooper::loopBlocks, for the events selected by
+ * jpsiFromBBlockPreCut (i.e. with mask set). The cuts are evaluated column-wise with the same formulas as used by
+ * TLorentzVector, so that the same events are selected and counted in the cutFlow. Only the cuts from the
+ * cowboy/seagull cut on are checked event by event for the events that pass all cuts before. Use jpsiFromBFill to
+ * fill the selected events.
+ */
+void jpsiFromBBlockSelection(const ColumnBlock& block, std::vector<char>& mask, CutFlow& cutFlow)
+{
+  const size_t n = block.size();
+  const Span<double> jpsiPx = block["JpsiP_px"], jpsiPy = block["JpsiP_py"];
+  const Span<double> jpsiPz = block["JpsiP_pz"], jpsiE = block["JpsiP_E"];
+  const Span<double> bPx = block["BplusP_px"], bPy = block["BplusP_py"];
+  const Span<double> trackPx = block["trackP_px"], trackPy = block["trackP_py"];
+  const Span<double> muPosPx = block["muPosP_px"], muPosPy = block["muPosP_py"], muPosPz = block["muPosP_pz"];
+  const Span<double> muNegPx = block["muNegP_px"], muNegPy = block["muNegP_py"], muNegPz = block["muNegP_pz"];
 
-  const double etaMuPos = inEvent.muPos().Eta();
-  const double pTmuPos = inEvent.muPos().Pt();
-  const double etaMuNeg = inEvent.muNeg().Eta();
-  const double pTmuNeg = inEvent.muNeg().Pt();
+  // number of passed cuts per event (see CutFlow::addStages), -1 for the events that are not selected on entry
+  std::vector<int> stage(n, -1);
+  std::vector<char> massOk(n);
+  for (size_t k = 0; k < n; ++k) {
+    if (!mask[k]) continue;
+    const double jpsiPt = std::sqrt(jpsiPx[k] * jpsiPx[k] + jpsiPy[k] * jpsiPy[k]);
+    const double bPt = std::sqrt(bPx[k] * bPx[k] + bPy[k] * bPy[k]);
+    const double trackPt = std::sqrt(trackPx[k] * trackPx[k] + trackPy[k] * trackPy[k]);
+    const double jpsiP2 = jpsiPx[k] * jpsiPx[k] + jpsiPy[k] * jpsiPy[k] + jpsiPz[k] * jpsiPz[k];
+    const double jpsiM2 = jpsiE[k] * jpsiE[k] - jpsiP2;
+    const double jpsiMass = jpsiM2 < 0 ? -std::sqrt(-jpsiM2) : std::sqrt(jpsiM2);
+    const double jpsiRap = 0.5 * std::log((jpsiE[k] + jpsiPz[k]) / (jpsiE[k] - jpsiPz[k]));
 
-  if (!isMuonInAcceptance(pTmuPos, std::abs(etaMuPos)) || !isMuonInAcceptance(pTmuNeg, std::abs(etaMuNeg))) return false;
+    // all cuts from the one after jpsiFromBPreCut to the one before the cowboy/seagull cut, in the order of
+    // JpsiFromBCut (negated as in passesJpsiFromBCut for NaN)
+    const bool pass[JpsiFromBCut::CowboysSeagulls - JpsiFromBCut::JpsiPtMax] = {
+      !(jpsiPt > 990.0), !(trackPt < config::JpsiFromBPS.trackPtCut), !(jpsiPt < config::JpsiFromBPS.jpsiPtCut),
+      !(bPt < config::JpsiFromBPS.bPtCut), !(std::abs(jpsiRap) > config::Jpsi.absRapMax)
+    };
+    int s = JpsiFromBCut::JpsiPtMax;
+    while (s < int(JpsiFromBCut::CowboysSeagulls) && pass[s - JpsiFromBCut::JpsiPtMax]) s++;
+    stage[k] = s;
+    massOk[k] = inRange(jpsiMass, config::Jpsi.massMin, config::Jpsi.massMax);
+  }
 
-  Reco_StatEv->Fill(5.5);
+  std::vector<int> selectedStages;
+  for (size_t k = 0; k < n; ++k) {
+    if (!mask[k]) continue;
+    mask[k] = 0;
+    selectedStages.push_back(stage[k]);
+    int& s = selectedStages.back();
+    if (s < int(JpsiFromBCut::CowboysSeagulls)) continue;
+    const double deltaPhi = reduceRange(std::atan2(muNegPy[k], muNegPx[k]) - std::atan2(muPosPy[k], muPosPx[k]));
+    if (config::JpsiFromBPS.RejectCowboys && deltaPhi < 0.) continue;
+    if (config::JpsiFromBPS.RejectSeagulls && deltaPhi > 0.) continue;
+    s++;
+    if (!massOk[k]) continue;
+    s++;
 
-  // Not here: (Left out for the moment)
-  // * removeEta0p2_0p3
-  // * cutDeltaREllDpt
+    const double pTmuPos = std::sqrt(muPosPx[k] * muPosPx[k] + muPosPy[k] * muPosPy[k]);
+    const double pTmuNeg = std::sqrt(muNegPx[k] * muNegPx[k] + muNegPy[k] * muNegPy[k]);
+    const double etaMuPos = pseudoRapidity(muPosPx[k], muPosPy[k], muPosPz[k]);
+    const double etaMuNeg = pseudoRapidity(muNegPx[k], muNegPy[k], muNegPz[k]);
+    if (!isMuonInAcceptance(pTmuPos, std::abs(etaMuPos)) || !isMuonInAcceptance(pTmuNeg, std::abs(etaMuNeg))) continue;
+
+    s++;
+    mask[k] = 1;
+  }
+
+  cutFlow.addStages(selectedStages);
+}
 
+/** fill the events selected by jpsiFromBBlockSelection. */
+bool jpsiFromBFill(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event)
+{
   event = inEvent;
   return true;
 }
 
+/**
+ * jpsiFromBPreSelection (or jpsiFromBAdaptiveSelection if adaptive is set) counting in its own CutFlow, so that
+ * copies can be used on different threads (see ParallelTTreeLooper) and be combined with merge afterwards. Every
+ * copy adapts the order of the cuts on its own.
+ */
+class JpsiFromBPreselector {
+public:
+  JpsiFromBPreselector(const unsigned timingPeriod = 0, const bool adaptive = false) :
+    m_cutFlow(jpsiFromBCutFlow(timingPeriod)), m_adaptiveCuts(jpsiFromBAdaptiveCuts()), m_adaptive(adaptive) {;}
+
+  JpsiFromBPreselector(const JpsiFromBPreselector& other) :
+    m_cutFlow(other.m_cutFlow), m_adaptiveCuts(other.m_adaptiveCuts), m_adaptive(other.m_adaptive) {;}
+
+  JpsiFromBPreselector& operator=(const JpsiFromBPreselector&) = delete;
+
+  bool operator()(const JpsiFromBInputEvent& inEvent, JpsiFromBEvent& event)
+  {
+    if (m_adaptive) return jpsiFromBAdaptiveSelection(inEvent, event, m_adaptiveCuts, m_cutFlow);
+    return jpsiFromBPreSelection(inEvent, event, m_cutFlow);
+  }
+
+  void merge(const JpsiFromBPreselector& other) { m_cutFlow.merge(other.m_cutFlow); }
+
+  const CutFlow& cutFlow() const { return m_cutFlow; }
+
+private:
+  CutFlow m_cutFlow;
+
+  AdaptiveCutSequence<JpsiFromBInputEvent> m_adaptiveCuts;
+
+  bool m_adaptive;
+};
+
 #endif
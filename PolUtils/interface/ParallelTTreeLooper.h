@@ -0,0 +1,232 @@
+#ifndef PHYSUTILS_POLUTILS_PARALLELTTREELOOPER_H__
+#define PHYSUTILS_POLUTILS_PARALLELTTREELOOPER_H__
+
+#include "general/root_utils.h"
+#include "general/progress.h"
+#include "general/work_stealing_pool.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TROOT.h"
+#include "RVersion.h"
+#include "ROOT/TBufferMerger.hxx"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <iostream>
+#include <algorithm>
+
+namespace looper_detail {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,22,0)
+  using BufferMerger = ROOT::TBufferMerger;
+  using BufferMergerFile = ROOT::TBufferMergerFile;
+#else
+  using BufferMerger = ROOT::Experimental::TBufferMerger;
+  using BufferMergerFile = ROOT::Experimental::TBufferMergerFile;
+#endif
+
+  template<typename CondF>
+  auto merge(CondF& cond, const CondF& other, int) -> decltype(cond.merge(other), void())
+  {
+    cond.merge(other);
+  }
+
+  template<typename CondF>
+  void merge(CondF&, const CondF&, long) {}
+}
+
+/** Settings for the parallel loop of a ParallelTTreeLooper. */
+struct LoopSettings {
+  unsigned nThreads{1}; /**< number of worker threads. */
+  long int minRangeSize{10000}; /**< consecutive clusters are combined into ranges of at least this many entries. */
+  bool ordered{false}; /**< keep the output entries in the order of the input entries. */
+  bool pruneBranches{true}; /**< read only the branches with an address set by InEventT::Init (see TTreeLooper). */
+};
+
+/** [begin, end) range of entries in a TTree or TChain. */
+struct EntryRange {
+  long int begin;
+  long int end;
+};
+
+/**
+ * Split the first nEntries entries of the tree (or chain) into ranges along the cluster boundaries of the
+ * underlying TTrees, such that every range starts at a cluster boundary and reading it touches only its own
+ * baskets. Consecutive clusters of the same file are combined until a range has at least minSize entries.
+ */
+std::vector<EntryRange> clusterRanges(TTree* tree, const long int nEntries, const long int minSize)
+{
+  std::vector<EntryRange> ranges;
+  long int entry{};
+  while (entry < nEntries) {
+    const long int local = tree->LoadTree(entry); // entry in the current file of a chain
+    TTree* current = tree->GetTree();
+    if (local < 0 || !current) break;
+    const long int offset = entry - local;
+    const long int fileEnd = std::min(nEntries, offset + static_cast<long int>(current->GetEntries()));
+
+    auto clusters = current->GetClusterIterator(local);
+    long int begin = entry;
+    long int start;
+    while ((start = offset + clusters.Next()) < fileEnd) {
+      const long int end = std::min(fileEnd, offset + static_cast<long int>(clusters.GetNextEntry()));
+      if (end - begin >= minSize) {
+        ranges.push_back(EntryRange{begin, end});
+        begin = end;
+      }
+    }
+    if (begin < fileEnd) ranges.push_back(EntryRange{begin, fileEnd});
+    if (fileEnd <= entry) break; // empty file, should not happen
+    entry = fileEnd;
+  }
+  return ranges;
+}
+
+/**
+ * Parallel version of the TTreeLooper, that reads the input files on several threads.
+ *
+ * The input entries are split into ranges along the cluster boundaries (see clusterRanges), which are processed by
+ * a WorkStealingPool. Every worker owns its own input TChain, InEventT, OutEventT and a copy of cond, and fills
+ * the output of every range into a TTree in its own TBufferMergerFile, which is merged into the output file in the
+ * background. If settings.ordered is set, the outputs of the ranges are handed to the merger in the order of the
+ * ranges, so that the output has the same order as the serial loop (ranges that are done too early are kept in
+ * memory until all ranges before them are done). Otherwise the order is not defined.
+ *
+ * cond has the same interface as for TTreeLooper::loop. It is copied once per worker, and if it provides
+ * \code{.cpp}
+ * void merge(const CondF& other);
+ * \endcode
+ * the copies are merged after the loop (e.g. to combine statistics collected while looping). loop returns the
+ * merged copy (or the copy of the first worker if CondF has no merge).
+ */
+template<typename InEventT, typename OutEventT>
+class ParallelTTreeLooper {
+public:
+  ParallelTTreeLooper() = delete;
+
+  /** read the TTree treeName from all inputFiles and write the output TTree to outFileName. */
+  ParallelTTreeLooper(const std::vector<std::string>& inputFiles, const std::string& treeName,
+                      const std::string& outFileName, const std::string& outTreeName,
+                      const std::string& outTreeTitle);
+
+  template<typename CondF, PrintStyle PS = PrintStyle::ProgressBar>
+  CondF loop(CondF cond, const LoopSettings& settings, const long int maxEvents = -1);
+
+  /** write an additional object into the output file (merged with all other output). */
+  void write(const TObject* obj);
+
+private:
+  std::vector<std::string> m_inputFiles;
+
+  std::string m_treeName;
+
+  std::string m_outTreeName;
+
+  std::string m_outTreeTitle;
+
+  std::unique_ptr<looper_detail::BufferMerger> m_merger;
+};
+
+template<typename InEventT, typename OutEventT>
+ParallelTTreeLooper<InEventT, OutEventT>::ParallelTTreeLooper(const std::vector<std::string>& inputFiles,
+                                                              const std::string& treeName,
+                                                              const std::string& outFileName,
+                                                              const std::string& outTreeName,
+                                                              const std::string& outTreeTitle) :
+  m_inputFiles(inputFiles), m_treeName(treeName), m_outTreeName(outTreeName), m_outTreeTitle(outTreeTitle)
+{
+  ROOT::EnableThreadSafety();
+  m_merger.reset(new looper_detail::BufferMerger(outFileName.c_str()));
+}
+
+template<typename InEventT, typename OutEventT>
+template<typename CondF, PrintStyle PS>
+CondF ParallelTTreeLooper<InEventT, OutEventT>::loop(CondF cond, const LoopSettings& settings,
+                                                     const long int maxEvents)
+{
+  using looper_detail::BufferMergerFile;
+
+  std::unique_ptr<TChain> chain(createTChain(m_inputFiles, m_treeName));
+  const long int nInputEvents = chain->GetEntries();
+  const long int nEvents = (maxEvents < 0 || maxEvents > nInputEvents) ? nInputEvents : maxEvents;
+  const std::vector<EntryRange> ranges = clusterRanges(chain.get(), nEvents, settings.minRangeSize);
+  chain.reset();
+
+  const unsigned nThreads = std::max(1u, settings.nThreads);
+  std::cout << "Looping over " << nEvents << " in " << ranges.size() << " ranges on " << nThreads << " threads\n";
+
+  // per worker state, created on this thread
+  std::vector<std::unique_ptr<TChain> > chains;
+  std::vector<std::unique_ptr<InEventT> > inEvents;
+  std::vector<std::unique_ptr<OutEventT> > outEvents;
+  std::vector<CondF> conds;
+  for (unsigned w = 0; w < nThreads; ++w) {
+    chains.emplace_back(createTChain(m_inputFiles, m_treeName));
+    inEvents.emplace_back(new InEventT());
+    inEvents.back()->Init(chains.back().get());
+    if (settings.pruneBranches) pruneUnusedBranches(chains.back().get(), w == 0);
+    outEvents.emplace_back(new OutEventT());
+    conds.push_back(cond);
+  }
+
+  std::mutex mutex; // for everything below
+  size_t count{};
+  size_t entriesDone{};
+  PercentProgress<PS> progress(nEvents);
+  std::map<size_t, std::shared_ptr<BufferMergerFile> > done; // finished ranges that can not be merged yet
+  size_t nextRange{};
+
+  WorkStealingPool pool(nThreads);
+  pool.start(ranges.size(), [&](const size_t r, const unsigned w) {
+      auto file = m_merger->GetFile();
+      file->cd();
+      TTree* outTree = new TTree(m_outTreeName.c_str(), m_outTreeTitle.c_str()); // owned by file
+      outTree->SetDirectory(file.get());
+      outEvents[w]->Create(outTree);
+
+      size_t rangeCount{};
+      for (long int i = ranges[r].begin; i < ranges[r].end; ++i) {
+        if (!checkGetEntry(chains[w].get(), i)) continue;
+        if (conds[w](*inEvents[w], *outEvents[w])) {
+          outTree->Fill();
+          rangeCount++;
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      count += rangeCount;
+      entriesDone += ranges[r].end - ranges[r].begin;
+      progress(entriesDone);
+      if (!settings.ordered) {
+        file->Write();
+        return;
+      }
+      done[r] = file;
+      while (!done.empty() && done.begin()->first == nextRange) {
+        done.begin()->second->Write();
+        done.erase(done.begin());
+        nextRange++;
+      }
+    });
+  pool.wait();
+
+  for (unsigned w = 1; w < nThreads; ++w) looper_detail::merge(conds[0], conds[w], 0);
+
+  std::cout << "number of reconstructed events: " << count << " of a total of " << nEvents << " events\n";
+  return conds[0];
+}
+
+template<typename InEventT, typename OutEventT>
+void ParallelTTreeLooper<InEventT, OutEventT>::write(const TObject* obj)
+{
+  auto file = m_merger->GetFile();
+  file->cd();
+  file->WriteTObject(obj);
+  file->Write();
+}
+
+#endif
@@ -1,14 +1,19 @@
 #ifndef PHYSUTILS_POLUTILS_TTREELOOPER_H__
 #define PHYSUTILS_POLUTILS_TTREELOOPER_H__
 
+#include "ColumnBlock.h"
+
 #include "general/root_utils.h"
 
 #include "general/progress.h"
 
 #include "TFile.h"
 #include "TTree.h"
+#include "TBranch.h"
 
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 
@@ -17,13 +22,44 @@ class TTreeLooper {
 public:
   TTreeLooper() = delete; /** do not want a default constructor */
 
-  /** ctor. */
-  TTreeLooper(TTree* inTree, TTree* outTree);
+  /**
+   * ctor. If pruneBranches is set, all branches of the input TTree whose address is not set by InEventT::Init are
+   * deactivated (see pruneUnusedBranches). Switch this off, if the input is accessed otherwise in the loop.
+   */
+  TTreeLooper(TTree* inTree, TTree* outTree, const bool pruneBranches = true);
 
   template<typename CondF, PrintStyle PS = PrintStyle::ProgressBar>
   void loop(CondF cond, const long int maxEvents = -1);
 
+  /**
+   * Same as loop, but reading every entry in two phases. First only the branches returned by
+   * InEventT::cutBranches() are read (with TBranch::GetEntry) and preCut(const InEventT&) is evaluated on them.
+   * Only if it returns true, all other (active) branches are read and cond is called.
+   * preCut must only access the members of InEventT that are filled from the cut branches, and cond has to apply
+   * (at least) the same cuts, so that the output is the same as with loop.
+   */
+  template<typename PreCutF, typename CondF, PrintStyle PS = PrintStyle::ProgressBar>
+  void loopCutFirst(PreCutF preCut, CondF cond, const long int maxEvents = -1);
+
+  /**
+   * Block version of loopCutFirst. Reads the flat columns (see BlockColumns) of blockSize entries at a time into a
+   * ColumnBlock (see BlockReader) and calls
+   * \code{.cpp}
+   * void preSelect(const ColumnBlock& block, std::vector<char>& mask);
+   * \endcode
+   * with mask set to 1 for all entries of the block, so that the cuts on the flat columns can be evaluated
+   * column-wise on the whole block. Only for the entries that are still selected afterwards the four-momentum
+   * columns are read and select (with the same interface) is called, which must only use the entries that are
+   * selected when it is called. For the entries that are still selected after that, all (active) branches are read
+   * and fill(const InEventT&, OutEventT&) is called, which decides if the entry is filled into the output TTree.
+   */
+  template<typename PreSelectF, typename SelectF, typename FillF, PrintStyle PS = PrintStyle::ProgressBar>
+  void loopBlocks(const BlockColumns<InEventT>& columns, PreSelectF preSelect, SelectF select, FillF fill,
+                  const size_t blockSize = 4096, const long int maxEvents = -1);
+
 private:
+  /** get the cut phase and the remaining active branches of the current TTree (of a TChain). */
+  void splitBranches(std::vector<TBranch*>& cutBranches, std::vector<TBranch*>& otherBranches) const;
 
   InEventT m_inEvent;
 
@@ -37,10 +73,11 @@ private:
 };
 
 template<typename InEventT, typename OutEventT>
-TTreeLooper<InEventT, OutEventT>::TTreeLooper(TTree* inTree, TTree* outTree) :
+TTreeLooper<InEventT, OutEventT>::TTreeLooper(TTree* inTree, TTree* outTree, const bool pruneBranches) :
   m_inTree(inTree), m_outTree(outTree)
 {
   m_inEvent.Init(m_inTree);
+  if (pruneBranches) pruneUnusedBranches(m_inTree);
 
   // m_outFile = new TFile(outFile.c_str(), "recreate");
   // m_outTree = new TTree(outTree.c_str(), outTree.c_str());
@@ -80,5 +117,123 @@ void TTreeLooper<InEventT, OutEventT>::loop(CondF cond, const long int maxEvents
   // m_outFile->Close();
 }
 
+template<typename InEventT, typename OutEventT>
+template<typename PreCutF, typename CondF, PrintStyle PS>
+void TTreeLooper<InEventT, OutEventT>::loopCutFirst(PreCutF preCut, CondF cond, const long int maxEvents)
+{
+  const long int nInputEvents = m_inTree->GetEntries();
+  const size_t nEvents = (maxEvents < 0 || maxEvents > nInputEvents) ? nInputEvents : maxEvents;
+
+  size_t count{};
+  size_t passedPreCut{};
+  std::vector<TBranch*> cutBranches;
+  std::vector<TBranch*> otherBranches;
+  int treeNumber = -1;
+
+  std::cout << "Looping over " << nEvents << " (reading the cut branches first)\n";
+  auto startTime = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < nEvents; ++i) {
+    const Long64_t entry = m_inTree->LoadTree(i); // sets the branch addresses when a TChain opens a new file
+    if (entry < 0) {
+      std::cerr << "I/O error while loading event " << i << " in TTree \'" << m_inTree->GetName() << "\'" << std::endl;
+      continue;
+    }
+    if (m_inTree->GetTreeNumber() != treeNumber) {
+      treeNumber = m_inTree->GetTreeNumber();
+      splitBranches(cutBranches, otherBranches);
+    }
+
+    bool readOk = true;
+    for (TBranch* branch : cutBranches) readOk &= branch->GetEntry(entry) >= 0;
+    if (readOk && preCut(m_inEvent)) {
+      passedPreCut++;
+      for (TBranch* branch : otherBranches) readOk &= branch->GetEntry(entry) >= 0;
+      if (!readOk) {
+        std::cerr << "I/O error while reading event " << i << " in TTree \'" << m_inTree->GetName() << "\'" << std::endl;
+      } else if (cond(m_inEvent, m_outEvent)) {
+        m_outTree->Fill();
+        count++;
+      }
+    }
+    printProgress<PS>(i, nEvents - 1, startTime); // -1 to reach 100 %
+  }
+
+  std::cout << passedPreCut << " events passed the cut phase\n";
+  std::cout << "number of reconstructed events: " << count << " of a total of " << nEvents << " events\n";
+}
+
+template<typename InEventT, typename OutEventT>
+template<typename PreSelectF, typename SelectF, typename FillF, PrintStyle PS>
+void TTreeLooper<InEventT, OutEventT>::loopBlocks(const BlockColumns<InEventT>& columns, PreSelectF preSelect,
+                                                  SelectF select, FillF fill, const size_t blockSize,
+                                                  const long int maxEvents)
+{
+  const long int nInputEvents = m_inTree->GetEntries();
+  const size_t nEvents = (maxEvents < 0 || maxEvents > nInputEvents) ? nInputEvents : maxEvents;
+
+  size_t count{};
+  size_t preSelected{};
+  size_t selected{};
+  BlockReader<InEventT> reader(m_inTree, m_inEvent, columns);
+  ColumnBlock block;
+  std::vector<char> mask;
+
+  std::cout << "Looping over " << nEvents << " in blocks of " << blockSize << "\n";
+  PercentProgress<PS> progress(nEvents);
+  size_t i{};
+  while (i < nEvents) {
+    const size_t nRead = reader.read(i, std::min(std::max(blockSize, size_t(1)), nEvents - i), block);
+    if (!nRead) { // skip the first event of the failed block and try again
+      i++;
+      continue;
+    }
+
+    mask.assign(nRead, 1);
+    preSelect(block, mask);
+    preSelected += std::count(mask.begin(), mask.end(), 1);
+    if (!reader.readFourMomenta(block, mask)) mask.assign(nRead, 0);
+    select(block, mask);
+    for (size_t k = 0; k < nRead; ++k) {
+      if (!mask[k] || !checkGetEntry(m_inTree, i + k)) continue;
+      selected++;
+      if (fill(m_inEvent, m_outEvent)) {
+        m_outTree->Fill();
+        count++;
+      }
+    }
+    i += nRead;
+    progress(i);
+  }
+
+  std::cout << preSelected << " events passed the cuts on the flat columns\n";
+  std::cout << selected << " events were selected on the blocks\n";
+  std::cout << "number of reconstructed events: " << count << " of a total of " << nEvents << " events\n";
+}
+
+template<typename InEventT, typename OutEventT>
+void TTreeLooper<InEventT, OutEventT>::splitBranches(std::vector<TBranch*>& cutBranches,
+                                                     std::vector<TBranch*>& otherBranches) const
+{
+  cutBranches.clear();
+  otherBranches.clear();
+  TTree* tree = m_inTree->GetTree();
+  const std::vector<std::string> cutNames = InEventT::cutBranches();
+
+  auto* branchObjList = tree->GetListOfBranches();
+  for (int i = 0; i < branchObjList->GetEntries(); ++i) {
+    TBranch* branch = static_cast<TBranch*>(branchObjList->At(i));
+    const std::string name = branch->GetName();
+    if (std::find(cutNames.begin(), cutNames.end(), name) != cutNames.end()) {
+      cutBranches.push_back(branch);
+    } else if (tree->GetBranchStatus(name.c_str())) {
+      otherBranches.push_back(branch);
+    }
+  }
+
+  if (cutBranches.size() != cutNames.size()) {
+    std::cerr << "Not all cut branches are present in TTree \'" << tree->GetName() << "\'" << std::endl;
+  }
+}
+
 
 #endif
@@ -1,4 +1,5 @@
 #include "TTreeLooper.h"
+#include "ParallelTTreeLooper.h"
 #include "JpsiFromBInputEvent.h"
 #include "BRootupleEvent.h"
 #include "JpsiFromBRootupling.h"
@@ -20,6 +21,19 @@ int main(int argc, char *argv[])
   const auto inputFiles = parser.getOptionVal<std::vector<std::string>>("--inputfiles");
   const auto outFileName = parser.getOptionVal<std::string>("--outfile");
   const int maxEvents = parser.getOptionVal<int>("--nevents", -1);
+  const unsigned nThreads = parser.getOptionVal<unsigned>("--nthreads", 1);
+  const bool ordered = parser.getOptionVal<bool>("--ordered", false);
+
+  if (nThreads > 1) {
+    LoopSettings settings;
+    settings.nThreads = nThreads;
+    settings.ordered = ordered;
+
+    ParallelTTreeLooper<JpsiFromBInputEvent, BRootupleEvent> treeLooper(inputFiles, "tree_jpsi", outFileName,
+                                                                        "rootuple", "rootupled events");
+    treeLooper.loop(jpsiFromBRootupling, settings, maxEvents);
+    return 0;
+  }
 
   TTree* tin = createTChain(inputFiles, "tree_jpsi");
 
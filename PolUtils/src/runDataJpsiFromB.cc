@@ -1,7 +1,11 @@
 #include "TTreeLooper.h"
+#include "ParallelTTreeLooper.h"
+#include "FanOutTTreeLooper.h"
 #include "JpsiFromBInputEvent.h"
 #include "JpsiFromBEvent.h"
 #include "JpsiFromBPreselection.h"
+#include "BRootupleEvent.h"
+#include "JpsiFromBRootupling.h"
 
 #include "general/ArgParser.h"
 #include "general/root_utils.h"
@@ -9,7 +13,6 @@
 #include "TFile.h"
 #include "TTree.h"
 #include "TChain.h"
-#include "TH1D.h"
 
 #include <vector>
 #include <string>
@@ -23,6 +26,43 @@ int main(int argc, char* argv[])
 
   const auto outfilename = inArgs.getOptionVal<std::string>("--outputfile");
   const auto inputfileNames = inArgs.getOptionVal<std::vector<std::string> >("--inputfiles");
+  const unsigned nThreads = inArgs.getOptionVal<unsigned>("--nthreads", 1);
+  const bool ordered = inArgs.getOptionVal<bool>("--ordered", false);
+  const size_t blockSize = inArgs.getOptionVal<size_t>("--blocksize", 0); // 0: event by event
+  // if set, also run the rootupling of bjpsikTuplizer in the same pass over the input
+  const auto rootupleFileName = inArgs.getOptionVal<std::string>("--rootuplefile", "");
+  // store the cut flow also as json file if set
+  const auto cutFlowFileName = inArgs.getOptionVal<std::string>("--cutflowjson", "");
+  // time the cuts on every n-th evaluation (0: no timing)
+  const unsigned cutTimingPeriod = inArgs.getOptionVal<unsigned>("--cuttiming", 0);
+  // apply the cuts in the order that is measured to be the fastest (not with --blocksize) and print the measured
+  // gain (on one thread). Without --rootuplefile and on one thread the cut branches are still read and cut on first,
+  // and only the cuts after that are reordered
+  const bool adaptiveCuts = inArgs.getOptionVal<bool>("--adaptivecuts", false);
+
+  if (!rootupleFileName.empty() && (nThreads > 1 || blockSize > 0)) {
+    std::cerr << "--rootuplefile is only possible with the event by event loop on one thread (not with --nthreads > 1 "
+              << "or --blocksize)" << std::endl;
+    return 1;
+  }
+
+  if (adaptiveCuts && blockSize > 0) {
+    std::cerr << "--adaptivecuts is not possible with --blocksize, which evaluates the cuts column-wise" << std::endl;
+    return 1;
+  }
+
+  if (nThreads > 1) {
+    LoopSettings settings;
+    settings.nThreads = nThreads;
+    settings.ordered = ordered;
+
+    ParallelTTreeLooper<JpsiFromBInputEvent, JpsiFromBEvent> treeLooper(inputfileNames, "tree_jpsi", outfilename,
+                                                                        "selectedData", "selected events");
+    const auto preselector = treeLooper.loop(JpsiFromBPreselector(cutTimingPeriod, adaptiveCuts), settings);
+    treeLooper.write(preselector.cutFlow().histogram().get());
+    if (!cutFlowFileName.empty()) preselector.cutFlow().writeJSON(cutFlowFileName);
+    return 0;
+  }
 
   // TChain* inChain = new TChain("tree_jpsi");
   // for (const auto& name : inputfileNames) {
@@ -35,15 +75,51 @@ int main(int argc, char* argv[])
   TTree* tout = new TTree("selectedData", "selected events");
   tout->SetDirectory(fout); // just to make sure this does not get a memory resident TTree
 
-  TH1D* Reco_StatEv = new TH1D("Reco_StatEv", "", 12, 0.0, 12.0);
-
-  TTreeLooper<JpsiFromBInputEvent, JpsiFromBEvent> treeLooper(tin, tout);
+  CutFlow cutFlow = jpsiFromBCutFlow(cutTimingPeriod);
+  auto cutSequence = jpsiFromBAdaptiveCuts();
 
   using namespace std::placeholders;
-  treeLooper.loop(std::bind(jpsiFromBPreSelection, _1, _2, Reco_StatEv), -1);
+  if (!rootupleFileName.empty()) {
+    TFile* fRootuple = new TFile(rootupleFileName.c_str(), "recreate");
+    TTree* tRootuple = new TTree("rootuple", "rootupled events");
+    tRootuple->SetDirectory(fRootuple);
+
+    FanOutTTreeLooper<JpsiFromBInputEvent> treeLooper(tin);
+    if (adaptiveCuts) {
+      treeLooper.addStage<JpsiFromBEvent>("selectedData", tout, std::bind(jpsiFromBAdaptiveSelection, _1, _2,
+                                                                          std::ref(cutSequence), std::ref(cutFlow)));
+    } else {
+      treeLooper.addStage<JpsiFromBEvent>("selectedData", tout,
+                                          std::bind(jpsiFromBPreSelection, _1, _2, std::ref(cutFlow)));
+    }
+    treeLooper.addStage<BRootupleEvent>("rootuple", tRootuple, jpsiFromBRootupling);
+    treeLooper.loop();
+    if (adaptiveCuts) cutSequence.printSummary();
+
+    fRootuple->Write();
+    fRootuple->Close();
+  } else {
+    TTreeLooper<JpsiFromBInputEvent, JpsiFromBEvent> treeLooper(tin, tout);
+
+    if (blockSize > 0) {
+      treeLooper.loopBlocks(jpsiFromBBlockColumns(), std::bind(jpsiFromBBlockPreCut, _1, _2, std::ref(cutFlow)),
+                            std::bind(jpsiFromBBlockSelection, _1, _2, std::ref(cutFlow)), jpsiFromBFill,
+                            blockSize, -1);
+    } else if (adaptiveCuts) {
+      // reading only the cut branches first saves more than any order of the cuts, so keep them first
+      auto afterPreCut = jpsiFromBAdaptiveCuts(JpsiFromBCut::JpsiPtMax, JpsiFromBCut::MuonAcceptance);
+      treeLooper.loopCutFirst(std::bind(jpsiFromBPreCut, _1, std::ref(cutFlow)),
+                              std::bind(jpsiFromBAdaptiveSelectionAfterPreCut, _1, _2, std::ref(afterPreCut),
+                                        std::ref(cutFlow)), -1);
+      afterPreCut.printSummary();
+    } else {
+      treeLooper.loopCutFirst(std::bind(jpsiFromBPreCut, _1, std::ref(cutFlow)),
+                              std::bind(jpsiFromBSelectionAfterPreCut, _1, _2, std::ref(cutFlow)), -1);
+    }
+  }
 
-  fout->cd();
-  Reco_StatEv->Write();
+  fout->WriteTObject(cutFlow.histogram().get());
+  if (!cutFlowFileName.empty()) cutFlow.writeJSON(cutFlowFileName);
 
   fout->Write();
   fout->Close();
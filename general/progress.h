@@ -120,4 +120,30 @@ void printProgressImpl<PrintStyle::None>(const size_t&, const size_t&, const dou
   return;
 }
 
+/**
+ * Progress printer for loops that advance in irregular (and possibly large) steps, for which the modulo check
+ * in printProgress does not work. Prints the progress whenever a new percent is completed.
+ */
+template<PrintStyle Style = PrintStyle::ProgressBar, typename ClockType = ProgressClock>
+class PercentProgress {
+public:
+  PercentProgress(const size_t N, std::ostream& os = std::cout) :
+    m_N(N ? N : 1), m_startTime(ClockType::now()), m_os(os) {;}
+
+  /** print the progress, if i completes a new percent. */
+  void operator()(const size_t i)
+  {
+    const size_t percent = 100 * i / m_N;
+    if (percent <= m_lastPercent && i != m_N) return;
+    m_lastPercent = percent;
+    printProgress<Style, ClockType>(i, m_N, m_startTime, m_N, m_os);
+  }
+
+private:
+  size_t m_N;
+  size_t m_lastPercent{};
+  typename ClockType::time_point m_startTime;
+  std::ostream& m_os;
+};
+
 #endif
@@ -8,6 +8,7 @@
 #include "TClass.h"
 #include "TCanvas.h"
 #include "TTree.h"
+#include "TBranch.h"
 #include "TObjArray.h"
 #include "TGraphAsymmErrors.h"
 #include "TChain.h"
@@ -155,6 +156,42 @@ std::vector<std::string> getBranchNames(TTree* t)
   return branchNames;
 }
 
+/**
+ * Deactivate all branches of the TTree (or TChain) that have no address set, e.g. after the Init of an input event
+ * class has set the addresses of the branches it uses, so that GetEntry only reads and decompresses these.
+ * Returns the names of the branches that stay active. If report is set, prints how many of the compressed bytes
+ * (of the current file for a TChain) are no longer read.
+ */
+std::vector<std::string> pruneUnusedBranches(TTree* t, const bool report = true)
+{
+  std::vector<std::string> active;
+  if (t->LoadTree(0) < 0 || !t->GetTree()) return active; // for a TChain this sets the addresses in the first file
+  auto* branchObjList = t->GetTree()->GetListOfBranches();
+
+  Long64_t totalBytes{};
+  Long64_t activeBytes{};
+  for (int i = 0; i < branchObjList->GetEntries(); ++i) {
+    const TBranch* branch = static_cast<TBranch*>(branchObjList->At(i));
+    const Long64_t bytes = branch->GetZipBytes("*"); // including all sub-branches
+    totalBytes += bytes;
+    if (branch->GetAddress()) {
+      active.push_back(branch->GetName());
+      activeBytes += bytes;
+    }
+  }
+
+  t->SetBranchStatus("*", false);
+  for (const auto& name : active) t->SetBranchStatus(name.c_str(), true);
+
+  if (report) {
+    std::cout << "Reading " << active.size() << " of " << branchObjList->GetEntries() << " branches of TTree \'"
+              << t->GetName() << "\': " << activeBytes / 1024 << " of " << totalBytes / 1024 << " kB compressed"
+              << " (saving " << (totalBytes ? 100 * (totalBytes - activeBytes) / totalBytes : 0) << " %)"
+              << std::endl;
+  }
+  return active;
+}
+
 RooRealVar* getVar(RooWorkspace* ws, const std::string& name)
 {
   auto* var = static_cast<RooRealVar*>(ws->var(name.c_str()));
@@ -0,0 +1,114 @@
+#ifndef PHYSUTILS_GENERAL_WORKSTEALINGPOOL_H__
+#define PHYSUTILS_GENERAL_WORKSTEALINGPOOL_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+
+/**
+ * Minimal work-stealing pool for a fixed set of independent tasks (identified by their index).
+ *
+ * Tasks are dealt out round-robin to one queue per worker. Each worker takes its tasks from the front of its own
+ * queue (i.e. roughly in ascending order). A worker that runs out of tasks steals from the back of the queue
+ * of another worker, so that tasks of very different sizes are still balanced over all workers.
+ * No tasks can be added once the pool has been started. Workers exit as soon as all queues are empty.
+ */
+class WorkStealingPool {
+public:
+  WorkStealingPool() = delete;
+
+  explicit WorkStealingPool(const unsigned nThreads);
+
+  /** joins all workers if wait() has not been called yet. */
+  ~WorkStealingPool() { wait(); }
+
+  /**
+   * Start the workers on the tasks 0, ..., nTasks - 1 and return immediately.
+   * func has to be callable as func(size_t task, unsigned worker), where worker is in [0, nThreads()).
+   * Calls to func for different tasks happen concurrently.
+   */
+  template<typename F>
+  void start(const size_t nTasks, F func);
+
+  /** block until all tasks have been processed. */
+  void wait();
+
+  unsigned nThreads() const { return m_nThreads; }
+
+private:
+  /** queue of one worker, with its own lock. */
+  struct TaskQueue {
+    std::deque<size_t> tasks;
+    std::mutex mutex;
+  };
+
+  /** get the next task for worker w either from its own queue or by stealing. false if all queues are empty. */
+  bool nextTask(const unsigned w, size_t& task);
+
+  unsigned m_nThreads;
+
+  std::vector<std::unique_ptr<TaskQueue> > m_queues;
+
+  std::vector<std::thread> m_workers;
+};
+
+WorkStealingPool::WorkStealingPool(const unsigned nThreads) : m_nThreads(nThreads ? nThreads : 1)
+{
+  for (unsigned i = 0; i < m_nThreads; ++i) {
+    m_queues.emplace_back(new TaskQueue());
+  }
+}
+
+template<typename F>
+void WorkStealingPool::start(const size_t nTasks, F func)
+{
+  for (size_t t = 0; t < nTasks; ++t) {
+    m_queues[t % m_nThreads]->tasks.push_back(t);
+  }
+
+  for (unsigned w = 0; w < m_nThreads; ++w) {
+    m_workers.emplace_back([this, w, func]() {
+        size_t task;
+        while (nextTask(w, task)) func(task, w);
+      });
+  }
+}
+
+void WorkStealingPool::wait()
+{
+  for (auto& worker : m_workers) {
+    if (worker.joinable()) worker.join();
+  }
+  m_workers.clear();
+}
+
+bool WorkStealingPool::nextTask(const unsigned w, size_t& task)
+{
+  {
+    TaskQueue& own = *m_queues[w];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  // own queue is empty -> try all others, starting with the next worker
+  for (unsigned i = 1; i < m_nThreads; ++i) {
+    TaskQueue& victim = *m_queues[(w + i) % m_nThreads];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+#endif